@@ -1,6 +1,9 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
+// Where to place the glyph: (offset x, offset y, scale x, scale y)
+uniform vec4 transform;
+
 void main() {
-    gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);
+    gl_Position = vec4(aPos.xy * transform.zw + transform.xy, aPos.z, 1.0);
 }
@@ -1,10 +1,14 @@
 #pragma once
 
 #include <array>
+#include <chrono>
+#include <filesystem>
 #include <vector>
 #include <string>
 
 #include "csvHandler.h"
+#include "gameState.h"
+#include "geometry.h"
 
 class Renderer {
     // Abstract much of the OpenGL setup and rendering calls
@@ -18,146 +22,135 @@ class Renderer {
 
         // Toggle wireframe mode
         void toggleWireframe();
+        bool isWireframe() const {return wireframe;}
 
-        // Set the vertices and indices to be drawn from an outside source
-        void setVertices(const std::pair<std::vector<float>, std::vector<int>> vertPair);
 
         // Called if a resize window event occurs
         void resize(const int width, const int height);
 
-        // Add vertices to the renderer to be drawn
-        void addVertices(const std::pair<std::vector<float>, std::vector<int>> vertPair);
+        // Render into an offscreen framebuffer instead of the window.
+        // Used in headless mode where there is no default framebuffer to draw to.
+        // Returns false if the framebuffer could not be created.
+        bool createOffscreenTarget(const int width, const int height);
+
+        // Add a glyph to be drawn every frame until the next reset
+        void addGlyph(const Geometry::Instance instance);
+
+        // Draw many boards in a single pass, each into its own tileSize x tileSize tile
+        // of the current render target. Tiles are laid out left to right, top to bottom
+        // in a columns x rows grid. Each entry holds the glyphs of a whole board placed
+        // as if it were drawn to the full screen.
+        void drawAtlas(const std::vector<std::pmr::vector<Geometry::Instance>>& tiles, const int tileSize, const int columns, const int rows);
 
         // Load a shader and return an empty string on failure
         // It will convert the text from the shader file into an
         // std::string object so that it can be compiled by OpenGL.
         std::string loadShader(const std::string filename);
 
+        // Recompile the shader program if a shader file changed on disk.
+        // Call once per frame. If the new shaders fail to build we keep the old program.
+        // Returns true if the program was replaced, which can change how every board looks.
+        bool pollShaderReload();
+
         // Returns true if the renderer initialized failed,
         // otherwise returns false
         bool initFailed() {return initFailure;}
 
-        // Reset to the initial state
+        // Reset to the initial state, with only the empty board left to draw
         void reset();
 
         // Clean up and shut down OpenGL and its context
         ~Renderer();
     
     private:
-        std::vector<float> vertices;
-        std::vector<int> indices;
-        int shaderProgramObject = 0;
-        int vertexArrayObject = 0;
+        // Build a shader program, loading it from the program binary cache if these
+        // exact sources were already built by this driver. Returns 0 on failure.
+        unsigned int buildProgram(const std::string& vertexShaderString, const std::string& fragmentShaderString);
+
+        // Compile and link a shader program from source. Returns 0 on failure.
+        unsigned int compileProgram(const std::string& vertexShaderString, const std::string& fragmentShaderString);
+
+        // Read back any finished GPU timer queries for the given ring slot and hand
+        // them to the profiler. Returns false if the slot's queries are still in flight.
+        bool collectGpuTimings(const int slot);
+
+        // Start watching the shader files for changes
+        void watchShaders();
+
+        // Returns true if a shader file changed since the last call
+        bool shadersChanged();
+
+        // Upload every glyph into a single set of static buffers
+        void uploadGlyphs(const std::array<Geometry::Mesh, Geometry::GLYPH_COUNT>& glyphs);
+
+        // Clear the target and draw a list of glyphs
+        void drawInstances(const std::vector<Geometry::Instance>& toDraw);
+
+        // The glyphs currently on the board
+        std::vector<Geometry::Instance> instances;
+
+        // Where each glyph's indices start in the element buffer, and how many it has
+        std::array<std::pair<int, int>, Geometry::GLYPH_COUNT> glyphRanges = {};
+
+        unsigned int shaderProgramObject = 0;
+        unsigned int vertexArrayObject = 0;
+        unsigned int vertexBufferObject = 0;
+        unsigned int elementBufferObject = 0;
+        int transformLocation = -1;
+
+        // Offscreen render target (only used in headless mode)
+        unsigned int framebufferObject = 0;
+        unsigned int colorRenderbuffer = 0;
+        unsigned int depthRenderbuffer = 0;
+
+        // GPU timer queries. Results arrive a few frames late, so we keep a ring
+        // of them and only read a slot back once the GPU is done with it.
+        static constexpr int queryRingSize = 4;
+        std::array<unsigned int, queryRingSize> elapsedQueries = {};
+        std::array<unsigned int, queryRingSize> timestampQueries = {};
+        std::array<bool, queryRingSize> queryPending = {};
+        int queryFrame = 0;
+        unsigned long long lastGpuTimestamp = 0;
+
+        // Shader file watching. inotify on Linux, modification times elsewhere.
+        int inotifyFd = -1;
+        std::filesystem::file_time_type vertexWriteTime;
+        std::filesystem::file_time_type fragmentWriteTime;
+        std::chrono::steady_clock::time_point lastShaderCheck;
 
         // If construction fails, will be set to true
         bool initFailure = false;
 
+        // Drawing outlines instead of filled shapes
+        bool wireframe = false;
+
         // To ensure that vertices have been set first
         bool readyToRender = false;
 
         // The number of dimensions per vertex. Currently there are 3
         const int dimNum = 3; 
-
-        // The number of vertices to offset when adding new indices
-        // to indices
-        int indexOffset = 0;
 };
 
-class GameBoard {
-    // The Tic Tac Toe board is composed of 9 cells
-    // A sector can either have nothing, an X, or a circle
-    // The board looks something like this:
-    /*
-        _|_|_
-        _|_|_
-         | |
-    */
+class GameBoard : public GameObserver {
+    // Draw a GameState. Attach it to a game with GameState::setObserver and
+    // the renderer will be kept up to date as moves are played.
     public:
         GameBoard(Renderer& renderer);
 
-        // Generate the OpenGL vertices and relevant indices for the board
-        // in normalized device coordinates
-        std::pair<std::vector<float>, std::vector<int>> generateBoardVertices();
-
-        // Place an X on the game board
-        void placeX(const int cellIndex);
+        // Draw the shape that was just placed
+        void onPlace(const int cellIndex, const GameState::CellState shape) override;
 
-        // Place a Circle on the game board
-        void placeCircle(const int cellIndex);
+        // Display the win screen
+        void onGameEnd(const std::pair<int, GameTypes::WinLine>& winData) override;
 
-        // Returns true if a cell is not occupied
-        bool canPlace(const int cellIndex) {
-            return grid[cellIndex / 3][cellIndex % 3] == CLEAR;
-        }
+        // Go back to an empty board
+        void onReset() override;
 
         // Draw the game board outline
         void drawBoard();
 
-        // Debug print the grid to output
-        void printGrid();
-
-        // Switch to the next player
-        void setNextTurn();
-
-        // Get who's turn it is
-        // 0 = X, 1 = Circle
-        int getTurn();
-
-        // Check if the game has been won or has ended in a draw
-        // Returns the integer corresponding to CellState for a win,
-        // returns the integer value of CellState.CLEAR for no win,
-        // returns -1 on draw.
-        std::pair<int, std::array<int, 3>> checkWin();
-
-        // Display the win screen, end the game
-        void endGame(const std::pair<int, std::array<int, 3>>);
-
-        // Check if the game is still playing
-        bool isOver() {return gameState != PLAYING && gameState != STARTING;}
-
-        // Reset to the initial state
-        void reset();
-
         ~GameBoard();
     private:
-        enum CellState {
-            CLEAR = 0,
-            CIRCLE = 1,
-            X = 2
-        };
-
-        enum GameState {
-            STARTING = 0,
-            PLAYING = 1,
-            X_WIN = 2,
-            C_WIN = 3,
-            DRAW = 4
-        };
-
-        // Will either be 1 or 0
-        unsigned int turn = 0;
-
-        // store the current GameState
-        GameState gameState = STARTING;
-
         // Reference to our OpenGL rendering object
         Renderer& glRenderer;
-        
-        // Reset the grid
-        void clearGrid();
-
-        // Draw a circle centered in specific a cell
-        std::pair<std::vector<float>, std::vector<int>> generateCircleVertices(const int cellIndex);
-
-        // Draw an X centered in specific a cell
-        std::pair<std::vector<float>, std::vector<int>> generateXVertices(const int cellIndex);
-
-        // Draw a line in across the winning set of 3 elements
-        std::pair<std::vector<float>, std::vector<int>> generateWinVertices(const std::array<int, 3> winVector);
-
-        // Get the proper coordinate range for each cell
-        std::array<std::array<float, 2>, 2> getCoordinateRange(const int cellIndex);
-
-        // A 2D array storing the current state of each tic-tac-toe cell on the grid 
-        std::array<std::array<CellState, 3>, 3> grid;
 };
\ No newline at end of file
@@ -1,14 +1,26 @@
 #include "glad/glad.h"
 #include <SFML/OpenGL.hpp>
 
+#include <chrono>
+#include <cstdint>
 #include <exception>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
 #include <iterator>
+#include <sstream>
 #include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 #include "Game.h"
 #include "constants.h"
+#include "profiler.h"
 
 Renderer::Renderer() {
     //*********************************************************
@@ -29,6 +41,99 @@ Renderer::Renderer() {
     // GL Setup
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
+    shaderProgramObject = buildProgram(vertexShaderString, fragmentShaderString);
+    if (!shaderProgramObject) {
+        initFailure = true;
+    }
+    transformLocation = glGetUniformLocation(shaderProgramObject, "transform");
+
+    // Build every glyph once. From here on, drawing a move is just adding an instance.
+    uploadGlyphs(Geometry::buildGlyphs(TTT::circleSegments));
+    reset();
+
+    // Timer queries for the profiler
+    glGenQueries(queryRingSize, elapsedQueries.data());
+    glGenQueries(queryRingSize, timestampQueries.data());
+
+    // Start watching the shader files so we can pick up edits while running
+    watchShaders();
+}
+
+unsigned int Renderer::buildProgram(const std::string& vertexShaderString, const std::string& fragmentShaderString) {
+    // Program binaries are only valid for the driver that produced them, so the driver
+    // is part of the key along with the shader sources.
+    const char* vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+    const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    const std::string key = vertexShaderString + '\0' + fragmentShaderString + '\0'
+        + (vendor ? vendor : "") + '\0' + (renderer ? renderer : "") + '\0' + (version ? version : "");
+
+    // 64-bit FNV-1a hash of the key names the cache file
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : key) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    std::stringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+    const std::filesystem::path cachePath = TTT::shaderCacheDir / name.str();
+
+    // Some drivers don't support program binaries at all
+    int binaryFormatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+    const bool cacheSupported = binaryFormatCount > 0;
+
+    // Try the cache first. The file holds the binary format followed by the binary itself.
+    if (cacheSupported) {
+        std::ifstream cacheFile(cachePath, std::ios::binary);
+        if (cacheFile) {
+            GLenum format = 0;
+            cacheFile.read(reinterpret_cast<char*>(&format), sizeof(format));
+            std::vector<char> binary((std::istreambuf_iterator<char>(cacheFile)), std::istreambuf_iterator<char>());
+
+            unsigned int program = glCreateProgram();
+            glProgramBinary(program, format, binary.data(), binary.size());
+            int linked = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (linked) {
+                std::cout << "Loaded shader program from cache " << cachePath.string() << std::endl;
+                return program;
+            }
+
+            // The driver rejected it (e.g. after an update). Fall through and rebuild.
+            std::cout << "Discarding stale shader cache " << cachePath.string() << std::endl;
+            glDeleteProgram(program);
+        }
+    }
+
+    unsigned int program = compileProgram(vertexShaderString, fragmentShaderString);
+    if (!program || !cacheSupported) {
+        return program;
+    }
+
+    // Save the linked program for next time
+    int binaryLength = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    if (binaryLength > 0) {
+        std::vector<char> binary(binaryLength);
+        GLenum format = 0;
+        glGetProgramBinary(program, binaryLength, NULL, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(cachePath.parent_path(), error);
+        std::ofstream cacheFile(cachePath, std::ios::binary | std::ios::trunc);
+        if (cacheFile) {
+            cacheFile.write(reinterpret_cast<const char*>(&format), sizeof(format));
+            cacheFile.write(binary.data(), binary.size());
+        } else {
+            std::cout << "Unable to write shader cache " << cachePath.string() << std::endl;
+        }
+    }
+    return program;
+}
+
+unsigned int Renderer::compileProgram(const std::string& vertexShaderString, const std::string& fragmentShaderString) {
+    bool failed = false;
+
     // Compile vertex shader
     const char* vertexShaderSource = vertexShaderString.c_str();
     unsigned int vertexShader;
@@ -43,7 +148,7 @@ Renderer::Renderer() {
     if (!vertexShaderCompilationSuccess) {
         glGetShaderInfoLog(vertexShader, 512, NULL, vertexInfoLog);
         std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << vertexInfoLog << std::endl;
-        initFailure = true;
+        failed = true;
     }
 
     // Compile fragment shader
@@ -60,7 +165,7 @@ Renderer::Renderer() {
     if (!fragmentShaderCompilationSuccess) {
         glGetShaderInfoLog(fragmentShader, 512, NULL, fragmentInfoLog);
         std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << fragmentInfoLog << std::endl;
-        initFailure = true;
+        failed = true;
     }
 
     // Setup shader program
@@ -68,6 +173,7 @@ Renderer::Renderer() {
     shaderProgram = glCreateProgram();
     glAttachShader(shaderProgram, vertexShader);
     glAttachShader(shaderProgram, fragmentShader);
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); // So we can cache it
     glLinkProgram(shaderProgram);
 
     // Check for shader program success
@@ -77,46 +183,207 @@ Renderer::Renderer() {
     if (!shaderProgramSuccess) {
         glGetProgramInfoLog(shaderProgram, 512, NULL, programInfoLog);
         std::cout << "ERROR::SHADER::PROGRAM::LINK_FAILED\n" << programInfoLog << std::endl;
-        initFailure = true;
+        failed = true;
     }
-    shaderProgramObject = shaderProgram; 
 
     // Delete the now unneeded (after linking) shader objects
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+
+    if (failed) {
+        glDeleteProgram(shaderProgram);
+        return 0;
+    }
+    return shaderProgram;
+}
+
+void Renderer::watchShaders() {
+#ifdef __linux__
+    // Editors often save by writing a new file and renaming it over the old one,
+    // so we watch the directory rather than the files themselves.
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        std::cout << "Unable to watch shaders for changes" << std::endl;
+        return;
+    }
+    if (inotify_add_watch(inotifyFd, TTT::shaderSourceDir.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cout << "Unable to watch shaders for changes" << std::endl;
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+#else
+    // No inotify, so we compare modification times instead
+    std::error_code error;
+    vertexWriteTime = std::filesystem::last_write_time(TTT::vertexShaderPath, error);
+    fragmentWriteTime = std::filesystem::last_write_time(TTT::fragmentShaderPath, error);
+#endif
+}
+
+bool Renderer::shadersChanged() {
+#ifdef __linux__
+    if (inotifyFd < 0) {
+        return false;
+    }
+
+    // Drain every pending event, remembering whether any of them were our shaders
+    bool changed = false;
+    alignas(inotify_event) char buf[4096];
+    ssize_t length;
+    while ((length = read(inotifyFd, buf, sizeof(buf))) > 0) {
+        for (char* ptr = buf; ptr < buf + length; ) {
+            const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+            if (event->len > 0) {
+                const std::string name = event->name;
+                if (name == "vertexShader.glsl" || name == "fragmentShader.glsl") {
+                    changed = true;
+                }
+            }
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+    return changed;
+#else
+    // Only stat the files a few times a second
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastShaderCheck < std::chrono::milliseconds(250)) {
+        return false;
+    }
+    lastShaderCheck = now;
+
+    std::error_code error;
+    const auto vertexTime = std::filesystem::last_write_time(TTT::vertexShaderPath, error);
+    const auto fragmentTime = std::filesystem::last_write_time(TTT::fragmentShaderPath, error);
+    if (error || (vertexTime == vertexWriteTime && fragmentTime == fragmentWriteTime)) {
+        return false;
+    }
+    vertexWriteTime = vertexTime;
+    fragmentWriteTime = fragmentTime;
+    return true;
+#endif
+}
+
+bool Renderer::pollShaderReload() {
+    if (!shadersChanged()) {
+        return false;
+    }
+
+    std::cout << "Shaders changed, reloading..." << std::endl;
+    std::string vertexShaderString = loadShader(TTT::vertexShaderPath);
+    std::string fragmentShaderString = loadShader(TTT::fragmentShaderPath);
+    if (vertexShaderString == "" || fragmentShaderString == "") {
+        return false;
+    }
+
+    // Keep the current program if the new one doesn't build so a typo doesn't kill the app
+    unsigned int program = buildProgram(vertexShaderString, fragmentShaderString);
+    if (!program) {
+        std::cout << "Keeping the previous shader program" << std::endl;
+        return false;
+    }
+    glDeleteProgram(shaderProgramObject);
+    shaderProgramObject = program;
+    transformLocation = glGetUniformLocation(shaderProgramObject, "transform");
+    return true;
+}
+
+bool Renderer::collectGpuTimings(const int slot) {
+    if (!queryPending[slot]) {
+        return true;
+    }
+
+    // Never wait on the GPU, just try again next frame
+    int available = 0;
+    glGetQueryObjectiv(elapsedQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return false;
+    }
+
+    GLuint64 elapsed = 0;
+    GLuint64 timestamp = 0;
+    glGetQueryObjectui64v(elapsedQueries[slot], GL_QUERY_RESULT, &elapsed);
+    glGetQueryObjectui64v(timestampQueries[slot], GL_QUERY_RESULT, &timestamp);
+    queryPending[slot] = false;
+
+    // Results are in nanoseconds. The time between consecutive timestamps is the GPU's frame time.
+    // The first results after profiling starts are skipped, some drivers report garbage for them.
+    if (lastGpuTimestamp != 0 && timestamp > lastGpuTimestamp) {
+        Profiler::get().record("gpu draw", elapsed / 1.0e6);
+        Profiler::get().record("gpu frame", (timestamp - lastGpuTimestamp) / 1.0e6);
+    }
+    lastGpuTimestamp = timestamp;
+    return true;
 }
 
 void Renderer::draw() {
+    drawInstances(instances);
+}
+
+void Renderer::drawInstances(const std::vector<Geometry::Instance>& toDraw) {
+    ScopeTimer timer("cpu draw");
     if (!readyToRender) {
         std::cout << "ERROR::DRAW::NOT_READY" << std::endl;
         return;
     }
 
+    // Time this draw on the GPU, unless the queries from queryRingSize frames ago aren't back yet
+    bool timing = false;
+    const int slot = queryFrame % queryRingSize;
+    if (Profiler::get().isEnabled()) {
+        if (collectGpuTimings(slot)) {
+            glQueryCounter(timestampQueries[slot], GL_TIMESTAMP);
+            glBeginQuery(GL_TIME_ELAPSED, elapsedQueries[slot]);
+            timing = true;
+        }
+    } else {
+        lastGpuTimestamp = 0;
+    }
+
     // Clear buffers
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Prepare to draw
+    // Prepare to draw. Every glyph lives in the same buffers, so we only
+    // change the transform and the range of indices between draws.
     glUseProgram(shaderProgramObject);
     glBindVertexArray(vertexArrayObject); // Remembers which buffers are bound already automatically
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    for (const auto& instance : toDraw) {
+        const auto& range = glyphRanges[instance.glyph];
+        glUniform4fv(transformLocation, 1, instance.transform.data());
+        glDrawElements(GL_TRIANGLES, range.second, GL_UNSIGNED_INT, reinterpret_cast<void*>(range.first * sizeof(int)));
+    }
     glBindVertexArray(0);
+
+    if (timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        queryPending[slot] = true;
+        queryFrame++;
+    }
 }
 
 void Renderer::toggleWireframe() {
-    // Default to true so that it turns on on the first call of this function
-    static bool showWires = true; 
-    if (showWires) {
+    // Starts off, so the first call turns it on
+    wireframe = !wireframe;
+    if (wireframe) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     } else {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
-    showWires = !showWires;
 }
 
-void Renderer::setVertices(const std::pair<std::vector<float>, std::vector<int>> vertPair) {
-    // TODO: We're recreating these buffers every time. Ideally we'd re-use them instead.
-    vertices = vertPair.first;
-    indices = vertPair.second;
+void Renderer::uploadGlyphs(const std::array<Geometry::Mesh, Geometry::GLYPH_COUNT>& glyphs) {
+    // Pack every glyph into one vertex buffer and one index buffer. Each glyph's indices
+    // are offset to point at its own vertices, so any glyph can be drawn on its own
+    // by drawing its range of indices.
+    std::vector<float> vertices;
+    std::vector<int> indices;
+    for (int glyph = 0; glyph < Geometry::GLYPH_COUNT; glyph++) {
+        const auto& mesh = glyphs[glyph];
+        const int indexOffset = vertices.size() / dimNum;
+        glyphRanges[glyph] = {static_cast<int>(indices.size()), static_cast<int>(mesh.second.size())};
+        for (auto index : mesh.second) {
+            indices.push_back(index + indexOffset);
+        }
+        vertices.insert(vertices.end(), mesh.first.begin(), mesh.first.end());
+    }
 
     // Create a vertex array object (VAO) to store vertex attribute states
     unsigned int VAO;
@@ -124,49 +391,95 @@ void Renderer::setVertices(const std::pair<std::vector<float>, std::vector<int>>
     glBindVertexArray(VAO);
     vertexArrayObject = VAO;
 
-    // Create a vertex buffer object to store the vertex data
-    unsigned int VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_DRAW);
+    // Create a vertex buffer object to store the vertex data. It never changes after this.
+    glGenBuffers(1, &vertexBufferObject);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
 
     // Store which indices OpenGL should use to draw
-    unsigned int EBO;
-    glGenBuffers(1, &EBO); 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * indices.size(), indices.data(), GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &elementBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferObject);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * indices.size(), indices.data(), GL_STATIC_DRAW);
 
     // Link the vertex attributes
     // Note that the previous VBO is still bound, so this will apply to that
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
 
     readyToRender = true;
 }
 
+void Renderer::addGlyph(const Geometry::Instance instance) {
+    ScopeTimer timer("addGlyph");
+    instances.push_back(instance);
+}
+
 void Renderer::resize(const int width, const int height) {
     glViewport(0, 0, width, height);
 }
 
-void Renderer::addVertices(const std::pair<std::vector<float>, std::vector<int>> vertPair) {
-    // TODO: This whole flow could be optimized a lot
-    auto addVerts = vertPair.first;
-    auto addIndices = vertPair.second;
-    auto currentVerts = vertices;
-    auto currentIndices = indices;
+bool Renderer::createOffscreenTarget(const int width, const int height) {
+    // Release the previous target if we're being resized
+    if (framebufferObject) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebufferObject);
+        glDeleteRenderbuffers(1, &colorRenderbuffer);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+    }
 
-    // Update the new indices to account for vertex offsets and add to the indices list
-    indexOffset = currentVerts.size() / dimNum;
-    for  (auto index : addIndices) {
-        currentIndices.push_back(index + indexOffset);
+    // Color attachment. We only ever read back GL_RGB, so no alpha needed.
+    glGenRenderbuffers(1, &colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB8, width, height);
+
+    // Depth and stencil to match the window's context settings
+    glGenRenderbuffers(1, &depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    // Binding to GL_FRAMEBUFFER makes this both the draw and read target,
+    // so glReadPixels in CSVHandler reads from it without any changes.
+    glGenFramebuffers(1, &framebufferObject);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebufferObject);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE" << std::endl;
+        return false;
     }
-    indexOffset += addVerts.size() / dimNum;
 
-    // Add the new vertices to current after updating index offset
-    currentVerts.insert(currentVerts.end(), addVerts.begin(), addVerts.end());
+    glViewport(0, 0, width, height);
+    return true;
+}
 
-    // Set the new vertices
-    setVertices(std::pair{currentVerts, currentIndices});
+void Renderer::drawAtlas(const std::vector<std::pmr::vector<Geometry::Instance>>& tiles, const int tileSize, const int columns, const int rows) {
+    // Each board covers [-1, 1] on each axis, so each tile covers 2 / columns of the atlas
+    // horizontally and 2 / rows vertically. Tile 0 is the top left. We fold the move into
+    // the tile into each glyph's transform and draw every glyph of every tile in one pass.
+    std::vector<Geometry::Instance> atlasInstances;
+    const float tileWidth = 2.0f / static_cast<float>(columns);
+    const float tileHeight = 2.0f / static_cast<float>(rows);
+    for (size_t tile = 0; tile < tiles.size(); tile++) {
+        const float scaleX = tileWidth * 0.5f;
+        const float scaleY = tileHeight * 0.5f;
+        const float centerX = -1.0f + tileWidth * static_cast<float>(tile % columns) + scaleX;
+        const float centerY = 1.0f - tileHeight * static_cast<float>(tile / columns) - scaleY;
+        for (const auto& instance : tiles[tile]) {
+            const auto& t = instance.transform;
+            atlasInstances.push_back(Geometry::Instance{instance.glyph, {
+                t[0] * scaleX + centerX,
+                t[1] * scaleY + centerY,
+                t[2] * scaleX,
+                t[3] * scaleY
+            }});
+        }
+    }
+
+    glViewport(0, 0, tileSize * columns, tileSize * rows);
+    drawInstances(atlasInstances);
 }
 
 std::string Renderer::loadShader(const std::string filename) {
@@ -185,12 +498,27 @@ std::string Renderer::loadShader(const std::string filename) {
 }
 
 void Renderer::reset() {
-    // TODO: This doesn't actually clean up any OpenGL memory!!!
-    indexOffset = 0;
-    vertices.clear();
-    indices.clear();
+    // The glyphs stay on the GPU, we just stop drawing them
+    instances.clear();
+    instances.push_back(Geometry::Instance{Geometry::BOARD, {0.0f, 0.0f, 1.0f, 1.0f}});
 }
 
 Renderer::~Renderer() {
-
+    glDeleteVertexArrays(1, &vertexArrayObject);
+    glDeleteBuffers(1, &vertexBufferObject);
+    glDeleteBuffers(1, &elementBufferObject);
+    glDeleteProgram(shaderProgramObject);
+    glDeleteQueries(queryRingSize, elapsedQueries.data());
+    glDeleteQueries(queryRingSize, timestampQueries.data());
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+    }
+#endif
+    if (framebufferObject) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebufferObject);
+        glDeleteRenderbuffers(1, &colorRenderbuffer);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <bit>
+#include <new>
+
+#include "arena.h"
+
+Arena::Arena(const size_t bytes) : buffer(new std::byte[std::max<size_t>(bytes, 1)]), size(std::max<size_t>(bytes, 1)) {}
+
+Arena::~Arena() {
+    while (overflow) {
+        const Overflow entry = *overflow;
+        ::operator delete(entry.block, entry.bytes, std::align_val_t(entry.alignment));
+        overflow = entry.previous;
+    }
+}
+
+Arena& Arena::local() {
+    // Made the first time each thread asks, so pool workers that never need one don't have one
+    thread_local Arena arena;
+    return arena;
+}
+
+void* Arena::do_allocate(const size_t bytes, const size_t alignment) {
+    // Round the end of what's in use up to the alignment
+    const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(buffer.get());
+    const size_t start = ((base + offset + alignment - 1) & ~std::uintptr_t(alignment - 1)) - base;
+    if (start + bytes <= size) {
+        offset = start + bytes;
+        peakBytes = std::max(peakBytes, offset + overflowBytes);
+        return buffer.get() + start;
+    }
+
+    // It doesn't fit, so it comes from new with its list entry just in front of it
+    const size_t align = std::max(alignment, alignof(Overflow));
+    const size_t header = (sizeof(Overflow) + align - 1) / align * align;
+    std::byte* block = static_cast<std::byte*>(::operator new(header + bytes, std::align_val_t(align)));
+    overflow = new (block + header - sizeof(Overflow)) Overflow{overflow, block, header + bytes, align};
+    overflowBytes += header + bytes;
+    overflowCount++;
+    peakBytes = std::max(peakBytes, offset + overflowBytes);
+    return block + header;
+}
+
+void Arena::rewind(const Mark& to) {
+    while (overflow && overflow != to.overflow) {
+        const Overflow entry = *overflow;
+        overflowBytes -= entry.bytes;
+        ::operator delete(entry.block, entry.bytes, std::align_val_t(entry.alignment));
+        overflow = entry.previous;
+    }
+    offset = to.offset;
+
+    // Nothing is using the buffer, so if it was too small this is the time to swap it for a bigger one
+    if (offset == 0 && !overflow && peakBytes > size) {
+        size = std::bit_ceil(peakBytes);
+        buffer.reset(new std::byte[size]);
+    }
+}
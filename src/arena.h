@@ -0,0 +1,89 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+
+#include "constants.h"
+
+class Arena : public std::pmr::memory_resource {
+    // A bump allocator for short lived temporaries, like the vectors a search, a game or a feature
+    // extraction builds and throws away. Allocating moves an offset along one buffer and freeing does
+    // nothing; everything allocated since a mark is freed at once by rewinding to it.
+    // Use it through Arena::Scope, which marks when it's made and rewinds when it's destroyed, and pass
+    // scope.resource() to anything that takes a std::pmr::memory_resource*. Scopes nest like the stack,
+    // so a search inside a game frees its temporaries and leaves the game's alone. Because of that, a
+    // function returning memory from its caller's resource allocates it before opening its own scope,
+    // in case the caller's resource is this same arena.
+    // If the buffer runs out, the rest comes from new and is freed at the rewind, and the next time the
+    // arena is empty its buffer grows to fit. After the first game or two nothing is allocated at all.
+    // Every thread has its own arena (Arena::local()), so there are no locks, and memory from an arena
+    // must not be used after its scope ends or on another thread while the scope is open.
+    public:
+        explicit Arena(const size_t bytes = TTT::arenaBytes);
+        ~Arena() override;
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // The calling thread's arena
+        static Arena& local();
+
+        // Where the arena was at some point, to rewind to
+        struct Mark {
+            size_t offset = 0;
+            void* overflow = nullptr;
+        };
+        Mark mark() const {return Mark{offset, overflow};}
+
+        // Free everything allocated since a mark. Marks have to be rewound in the reverse order they were taken.
+        void rewind(const Mark& to);
+
+        // Bytes in the buffer, and the most the arena has held at once
+        size_t capacity() const {return size;}
+        size_t peak() const {return peakBytes;}
+
+        // Allocations that didn't fit in the buffer and went to new instead
+        std::uint64_t overflows() const {return overflowCount;}
+
+        class Scope {
+            // Frees everything allocated from the arena while it's alive
+            public:
+                explicit Scope(Arena& arena = Arena::local()) : arena(arena), start(arena.mark()) {}
+                ~Scope() {arena.rewind(start);}
+
+                Scope(const Scope&) = delete;
+                Scope& operator=(const Scope&) = delete;
+
+                std::pmr::memory_resource* resource() {return &arena;}
+
+            private:
+                Arena& arena;
+                Mark start;
+        };
+
+    private:
+        // An allocation that didn't fit. They're kept in a list, newest first, in front of the memory handed out.
+        struct Overflow {
+            Overflow* previous;
+            void* block;
+            size_t bytes;
+            size_t alignment;
+        };
+
+        void* do_allocate(const size_t bytes, const size_t alignment) override;
+        void do_deallocate(void*, const size_t, const size_t) override {} // Freed by rewind
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {return this == &other;}
+
+        std::unique_ptr<std::byte[]> buffer;
+        size_t size;
+        size_t offset = 0;
+        Overflow* overflow = nullptr;
+        size_t overflowBytes = 0; // Held outside the buffer right now
+        size_t peakBytes = 0;
+        std::uint64_t overflowCount = 0;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "boardFeatures.h"
+#include "gameState.h"
+#include "policy.h"
+#include "symmetry.h"
+
+// Counts every allocation the program makes, so we can see what a game costs.
+// Replacing the global operators only affects this executable.
+namespace {
+    std::atomic<std::uint64_t> allocations = 0;
+
+    void* counted(const std::size_t bytes, const std::size_t alignment) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        void* memory = alignment > alignof(std::max_align_t)
+            ? std::aligned_alloc(alignment, (std::max<std::size_t>(bytes, 1) + alignment - 1) / alignment * alignment)
+            : std::malloc(std::max<std::size_t>(bytes, 1));
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+}
+
+void* operator new(const std::size_t bytes) {return counted(bytes, alignof(std::max_align_t));}
+void* operator new[](const std::size_t bytes) {return counted(bytes, alignof(std::max_align_t));}
+void* operator new(const std::size_t bytes, const std::align_val_t alignment) {return counted(bytes, static_cast<std::size_t>(alignment));}
+void* operator new[](const std::size_t bytes, const std::align_val_t alignment) {return counted(bytes, static_cast<std::size_t>(alignment));}
+void operator delete(void* memory) noexcept {std::free(memory);}
+void operator delete[](void* memory) noexcept {std::free(memory);}
+void operator delete(void* memory, std::size_t) noexcept {std::free(memory);}
+void operator delete[](void* memory, std::size_t) noexcept {std::free(memory);}
+void operator delete(void* memory, std::align_val_t) noexcept {std::free(memory);}
+void operator delete[](void* memory, std::align_val_t) noexcept {std::free(memory);}
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {std::free(memory);}
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {std::free(memory);}
+
+namespace {
+    struct Run {
+        std::string name;
+        std::string xSpec;
+        std::string oSpec;
+        bool features; // Turn every move into augmented rows, like training mode with augmentation
+        size_t games;
+    };
+
+    // Play a run's games one after another on this thread, each in its own arena scope, and print
+    // the allocations the first game made and the average over every game after it
+    void play(const Run& run, const std::uint32_t seed) {
+        const auto xPolicy = createPolicy(run.xSpec);
+        const auto oPolicy = createPolicy(run.oSpec);
+        std::mt19937 rng(seed);
+        GameState game;
+        std::string rows;
+        size_t rowCount = 0;
+
+        // The rows are the output, not temporaries, so each one is an allocation we have to make and isn't counted
+        std::uint64_t firstGame = 0;
+        std::uint64_t laterGames = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t g = 0; g < run.games; g++) {
+            const std::uint64_t before = allocations.load() - rowCount;
+            {
+                Arena::Scope gameScope;
+                game.reset();
+                while (!game.isOver()) {
+                    Policy& policy = game.getTurn() == 0 ? *xPolicy : *oPolicy;
+                    const int move = policy.chooseMove(game, rng);
+                    if (move < 0) {
+                        break;
+                    }
+                    if (run.features) {
+                        const GameState::Grid grid = game.getGrid();
+                        for (const int s : Symmetry::distinctVariants(grid, move, gameScope.resource())) {
+                            rows = Features::formatRow(Features::extract(Symmetry::mapGrid(s, grid), gameScope.resource()), Symmetry::mapCell(s, move));
+                            rowCount++;
+                        }
+                    }
+                    game.playMove(move);
+                }
+            }
+            const std::uint64_t made = allocations.load() - rowCount - before;
+            if (g == 0) {
+                firstGame = made;
+            } else {
+                laterGames += made;
+            }
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double perGame = run.games > 1 ? static_cast<double>(laterGames) / (run.games - 1) : 0.0;
+        std::cout << run.name << " (" << run.xSpec << " vs " << run.oSpec << "), " << run.games << " games in " << seconds << "s" << std::endl;
+        std::cout << "    first game: " << firstGame << " allocations, after that: " << perGame << " per game" << std::endl;
+        std::cout << "    arena: " << Arena::local().capacity() << " bytes, peak " << Arena::local().peak()
+                  << ", " << Arena::local().overflows() << " overflows so far" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Parse command line flags
+    size_t games = 2000;
+    size_t featureGames = 20;
+    std::uint32_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--games" && hasValue) {
+            games = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (arg == "--feature-games" && hasValue) {
+            featureGames = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: bench_alloc [--games N] [--feature-games N] [--seed N]" << std::endl;
+            return -1;
+        }
+    }
+
+    // Build the perfect policy's table before anything is counted
+    std::mt19937 warmup(seed);
+    PerfectPolicy().chooseMove(GameState(), warmup);
+
+    const std::vector<Run> runs = {
+        {"Random play", "random", "random", false, games},
+        {"Perfect play", "perfect", "epsilon:0.3", false, games},
+        {"Search", "search", "random", false, games},
+        {"Monte Carlo tree search", "mcts:2", "random", false, std::max<size_t>(1, games / 20)},
+        {"Augmented features", "perfect", "random", true, featureGames}
+    };
+    for (const Run& run : runs) {
+        play(run, seed);
+    }
+    return 0;
+}
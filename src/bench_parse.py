@@ -0,0 +1,102 @@
+# Benchmark parsing a training log: the old per-cell Python conversion against the
+# vectorized parser in rowparse.py, on a synthetic log.
+#
+# Usage: python bench_parse.py [--rows N] [--old-rows N] [--log FILE] [--keep]
+#   --rows      rows in the synthetic log (default 10,000,000)
+#   --old-rows  rows the old parser is timed on, since it's far slower (default 1,000,000)
+#   --log       where to write the log (default a temporary file)
+#   --keep      don't delete the log afterwards
+import argparse
+import io
+import os
+import tempfile
+import time
+
+import numpy as np
+from pandas import read_csv
+
+from rowparse import parse_log_bytes
+
+HEADER = b"1,2,3,4,5,6,7,8,9,next_move\n"
+DIGITS = np.frombuffer(b"0123456789abcdef", dtype=np.uint8)
+
+def sanitize_features(features):
+    # The conversion model.py used before rowparse.py, kept here to compare against
+    for row in range(len(features)):
+        for x in range(len(features[row])):
+            if not str(features[row][x]).isdigit():
+                features[row][x] = int(features[row][x], 16)
+            else:
+                features[row][x] = int(features[row][x])
+
+def write_log(path, rows, seed=0):
+    # Rows of random features and moves in the format CSVHandler writes, built a block at a time
+    rng = np.random.default_rng(seed)
+    block = 1 << 20
+    with open(path, "wb") as f:
+        f.write(HEADER)
+        for first in range(0, rows, block):
+            count = min(block, rows - first)
+            lines = np.full((count, 20), ord(","), dtype=np.uint8)
+            lines[:, 0:18:2] = DIGITS[rng.integers(0, 16, size=(count, 9))]
+            lines[:, 18] = DIGITS[rng.integers(0, 9, size=count)]
+            lines[:, 19] = ord("\n")
+            f.write(lines.tobytes())
+
+def read_body(path, rows=None):
+    # Everything after the header, optionally only the first rows
+    with open(path, "rb") as f:
+        f.readline()
+        return f.read() if rows is None else f.read(rows * 20)
+
+def old_parse(buf):
+    data = read_csv(io.BytesIO(buf), header=None)
+    features = data.values[:, 0:9]
+    classes = data.values[:, 9]
+    sanitize_features(features)
+    return features.astype(np.uint8), classes.astype(np.uint8)
+
+def time_parse(name, parse, buf, rows):
+    start = time.perf_counter()
+    result = parse(buf)
+    seconds = time.perf_counter() - start
+    print(f"{name}: {rows:,} rows in {seconds:.3f} s ({rows / max(seconds, 1e-9):,.0f} rows/s)")
+    return result, rows / max(seconds, 1e-9)
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--rows", type=int, default=10_000_000)
+    parser.add_argument("--old-rows", type=int, default=1_000_000)
+    parser.add_argument("--log")
+    parser.add_argument("--keep", action="store_true")
+    args = parser.parse_args()
+
+    path = args.log or os.path.join(tempfile.gettempdir(), "bench_parse_log.csv")
+    start = time.perf_counter()
+    write_log(path, args.rows)
+    print(f"Wrote {args.rows:,} rows to {path} in {time.perf_counter() - start:.1f} s")
+
+    try:
+        # Both parsers on the same subset, which also checks they agree
+        old_rows = min(args.old_rows, args.rows)
+        subset = read_body(path, old_rows)
+        (old_features, old_classes), old_rate = time_parse("old (pandas + sanitize_features)", old_parse, subset, old_rows)
+        (new_features, new_classes), _ = time_parse("new (rowparse) on the same rows", parse_log_bytes, subset, old_rows)
+        if not (np.array_equal(old_features, new_features) and np.array_equal(old_classes, new_classes)):
+            print("ERROR: the parsers disagree")
+            return 1
+
+        # Then the new parser on the whole log
+        body = read_body(path)
+        (features, _), new_rate = time_parse("new (rowparse) on the whole log", parse_log_bytes, body, args.rows)
+        if len(features) != args.rows:
+            print("ERROR: parsed", len(features), "rows, expected", args.rows)
+            return 1
+        print(f"Speedup: {new_rate / old_rate:.1f}x")
+    finally:
+        if not args.keep:
+            os.remove(path)
+    return 0
+
+if __name__ == "__main__":
+    raise SystemExit(main())
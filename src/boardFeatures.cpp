@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+#include "boardFeatures.h"
+#include "arena.h"
+#include "geometry.h"
+#include "constants.h"
+
+template <int M, int N>
+std::pmr::vector<int> Features::reduceTile(const unsigned char* data, const int rowStride, const int width, const int height, std::pmr::memory_resource* memory) {
+    // Each row of pixels has TTT::screenWidth * 3 bytes. Each row has TTT::screenWidth pixels. So, for 600x600 resolution, we have 1800 bytes per row. We have 600 rows. So in total, we're dealing with ~1M bytes.
+    // To reduce our data, we average every pixel together, which reduces us to 600 bytes per row for example. Now, we're dealing with a 600x600 grid. This is still far too large, so we will average every 200x200
+    // area together. This would reduce our total output feature space to 9 dimensions.
+    // The tile doesn't have to be the whole screen. In atlas mode many boards share one capture, so we read
+    // each tile through rowStride (bytes between the starts of two rows) and scale every constant by the tile size.
+    // For a 600x600 tile these are exactly the original hardcoded values.
+    // Boards of other sizes are split the same way, into N bands across and M bands down.
+
+    // Practically, this means that in every row we average each 600 bytes (200 pixels) into 1 byte. This should yield 3 bytes per row. We then inspect the value of each byte and clamp it to the range [0-15] so we can use it as HEX.
+    // So, we should get 3 HEX characters per row. Then, we avaerage the first 200 rows in each column, then the 2nd 200 rows, then the 3rd 200, in each column (clamping the same), to yield a 3x3 grid of 9 HEX characters after every move.
+    const int thirdBytes = (width / N) * 3; // (width / 3) pixels * 3 bytes per pixel
+    const int thirdRows = height / M;
+
+    // The result has to be allocated before the scratch scope opens, in case memory is the same arena
+    std::pmr::vector<int> colResults(memory);
+    colResults.reserve(M * N);
+    Arena::Scope scratch;
+
+    // handle row reducing
+    std::pmr::vector<int> rowResults(scratch.resource());
+    rowResults.reserve(height * N);
+    for (int row = 0; row < height; ++row) {
+        for (int j = 0; j < N; j++) {
+            int sum = 0;
+            // Each row is 1800 bytes long, average every 600 bytes (200 pixels * 3 bytes per pixel).
+            // Iterate through the rows by multiplying the current row number by the length of each row.
+            // j corresponds to which third we're averaging in the row.
+            int offset = row * rowStride;
+            for (int i = 0; i < thirdBytes; i++) {
+                sum += static_cast<int>(data[offset + i + j * thirdBytes]);
+            }
+            sum /= thirdBytes; // divide by 600 to get within the range 0 - 255
+            rowResults.push_back(sum);
+        }
+    }
+
+    // handle column reduction
+    // Rows are put in a band by their index into rowResults rather than by their row, so the bands aren't
+    // even (on a 3x3 board the first band down is the first ninth of the rows). Every row the model has
+    // been trained on was made this way, so it stays.
+    for (int col = 0; col < N; col++) {
+        std::array<int, M> sums = {};
+
+        // Iterate over each column
+        for (int i = 0; i < height; i++) {
+            int index = i * N + col; // Index is column offset + the current i value * 3 since we have 1800 total values
+            sums[std::min(index / thirdRows, M - 1)] += rowResults[index]; // If in the first 3rd, add to 1st sum, and so on
+        }
+
+        for (auto s : sums) {
+            colResults.push_back(s / thirdRows);
+        }
+    }
+
+    // adjust column values so they're in the range 0-15. With the uneven bands the last band down can
+    // add up to more than 255 on bigger boards, so anything over 15 is clamped (a 3x3 board never gets past 10).
+    for (auto iter = colResults.begin(); iter != colResults.end(); iter++) {
+        *iter = std::min(*iter / 16, 15);
+    }
+    return colResults;
+}
+
+std::string Features::formatRow(const std::span<const int> features, const int move) {
+    // Features in hex, the move in decimal. Written straight into the row (rather than through a
+    // stringstream) so the row is the only thing allocated.
+    std::string row;
+    row.reserve(features.size() * 3 + 4);
+    char digits[16];
+    for (auto val : features) {
+        row.append(digits, std::to_chars(digits, digits + sizeof(digits), val, 16).ptr);
+        row += ',';
+    }
+    row.append(digits, std::to_chars(digits, digits + sizeof(digits), move).ptr);
+    return row;
+}
+
+std::string Features::formatBoard(const GameState::Grid& grid, const int move) {
+    // 9 cells, a comma and the move fit in the string itself, so nothing is allocated
+    std::string board;
+    for (int cell = 0; cell < GameState::cells; cell++) {
+        switch (grid[cell / GameState::cols][cell % GameState::cols]) {
+            case GameState::X:
+                board += 'X';
+                break;
+            case GameState::CIRCLE:
+                board += 'C';
+                break;
+            default:
+                board += '_';
+                break;
+        }
+    }
+    board += ',';
+    char digits[16];
+    board.append(digits, std::to_chars(digits, digits + sizeof(digits), move).ptr);
+    return board;
+}
+
+bool Features::parseBoard(const std::string_view line, GameState::Grid& grid, int& move) {
+    if (line.size() < GameState::cells + 2 || line[GameState::cells] != ',') {
+        return false;
+    }
+    for (int cell = 0; cell < GameState::cells; cell++) {
+        GameState::CellState state;
+        switch (line[cell]) {
+            case 'X':
+            case 'x':
+                state = GameState::X;
+                break;
+            case 'C':
+            case 'c':
+            case 'O':
+            case 'o':
+                state = GameState::CIRCLE;
+                break;
+            case '_':
+                state = GameState::CLEAR;
+                break;
+            default:
+                return false;
+        }
+        grid[cell / GameState::cols][cell % GameState::cols] = state;
+    }
+    const char* end = line.data() + line.size();
+    if (end[-1] == '\r') {
+        end--;
+    }
+    const auto parsed = std::from_chars(line.data() + GameState::cells + 1, end, move);
+    return parsed.ec == std::errc() && parsed.ptr == end && move >= 0 && move < GameState::cells;
+}
+
+size_t Features::Pyramid::cells() const {
+    size_t total = 0;
+    for (const int level : levels) {
+        total += static_cast<size_t>(level) * level;
+    }
+    return total;
+}
+
+bool Features::parsePyramid(const std::string& levels, const int bits, Pyramid& pyramid) {
+    pyramid.levels.clear();
+    pyramid.bits = bits;
+    if (bits != 4 && bits != 8) {
+        std::cerr << "ERROR::FEATURES::PYRAMID_BITS must be 4 or 8, not " << bits << std::endl;
+        return false;
+    }
+    const char* at = levels.data();
+    const char* end = levels.data() + levels.size();
+    while (at < end) {
+        int level = 0;
+        const auto parsed = std::from_chars(at, end, level);
+        if (parsed.ec != std::errc() || level < 1 || level > std::min(TTT::screenWidth, TTT::screenHeight) || (parsed.ptr != end && *parsed.ptr != ',')) {
+            std::cerr << "ERROR::FEATURES::PYRAMID_LEVELS " << levels << ", expected sizes like 3,9,30" << std::endl;
+            pyramid.levels.clear();
+            return false;
+        }
+        pyramid.levels.push_back(level);
+        at = parsed.ptr + (parsed.ptr != end);
+    }
+    return pyramid.enabled();
+}
+
+std::pmr::vector<std::uint8_t> Features::pyramid(const unsigned char* data, const int rowStride, const int width, const int height, const Pyramid& spec, std::pmr::memory_resource* memory) {
+    std::pmr::vector<std::uint8_t> result(memory);
+    result.reserve(spec.cells());
+    Arena::Scope scratch;
+
+    // The one pass over the pixels. Row y + 1 and column x + 1 of the integral image hold the sum of
+    // every byte of the pixels above and left of screen pixel (x, y), counting from the top.
+    const int stride = width + 1;
+    std::pmr::vector<std::uint32_t> integral(static_cast<size_t>(stride) * (height + 1), 0, scratch.resource());
+    for (int y = 0; y < height; y++) {
+        const unsigned char* pixel = data + static_cast<size_t>(height - 1 - y) * rowStride;
+        const std::uint32_t* above = integral.data() + static_cast<size_t>(y) * stride;
+        std::uint32_t* here = integral.data() + static_cast<size_t>(y + 1) * stride;
+        std::uint32_t rowSum = 0;
+        for (int x = 0; x < width; x++, pixel += 3) {
+            rowSum += pixel[0] + pixel[1] + pixel[2];
+            here[x + 1] = above[x + 1] + rowSum;
+        }
+    }
+
+    // Blocks start and end on whole pixels, so when a level doesn't divide the screen some are a pixel wider
+    for (const int level : spec.levels) {
+        for (int by = 0; by < level; by++) {
+            const int y0 = by * height / level;
+            const int y1 = (by + 1) * height / level;
+            for (int bx = 0; bx < level; bx++) {
+                const int x0 = bx * width / level;
+                const int x1 = (bx + 1) * width / level;
+                const std::uint32_t sum = integral[static_cast<size_t>(y1) * stride + x1] - integral[static_cast<size_t>(y0) * stride + x1]
+                                        - integral[static_cast<size_t>(y1) * stride + x0] + integral[static_cast<size_t>(y0) * stride + x0];
+                const std::uint32_t average = sum / std::max(1u, static_cast<std::uint32_t>((x1 - x0) * (y1 - y0) * 3));
+                result.push_back(static_cast<std::uint8_t>(spec.bits == 8 ? average : average >> 4));
+            }
+        }
+    }
+    return result;
+}
+
+std::string Features::datasetPath(const std::string& logPath) {
+    return std::filesystem::path(logPath).replace_extension(".tttset").string();
+}
+
+std::string Features::boardsPath(const std::string& logPath) {
+    const std::filesystem::path path(logPath);
+    return (path.parent_path() / (path.stem().string() + "_boards" + path.extension().string())).string();
+}
+
+template <int M, int N>
+std::pmr::vector<unsigned char> Features::rasterize(const std::type_identity_t<BasicGrid<M, N>>& grid, const int width, const int height, std::pmr::memory_resource* memory) {
+    // We follow OpenGL's rules: a pixel is covered if its center is inside a triangle,
+    // and a center exactly on an edge only counts for top and left edges, so shared
+    // edges are never drawn twice or skipped.
+    std::pmr::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 3, 0, memory);
+    static const auto glyphs = Geometry::buildGlyphs<M, N>(TTT::circleSegments);
+
+    Arena::Scope scratch;
+    for (const auto& instance : Geometry::gridInstances<M, N>(grid, scratch.resource())) {
+        const auto& mesh = glyphs[instance.glyph];
+        const auto& t = instance.transform;
+
+        // Place each vertex (like the vertex shader) then move it to window coordinates
+        std::pmr::vector<std::array<float, 2>> points(scratch.resource());
+        points.reserve(mesh.first.size() / 3);
+        for (size_t i = 0; i < mesh.first.size(); i += 3) {
+            const float x = mesh.first[i] * t[2] + t[0];
+            const float y = mesh.first[i + 1] * t[3] + t[1];
+            points.push_back({(x + 1.0f) * 0.5f * width, (y + 1.0f) * 0.5f * height});
+        }
+
+        for (size_t i = 0; i + 2 < mesh.second.size(); i += 3) {
+            auto a = points[mesh.second[i]];
+            auto b = points[mesh.second[i + 1]];
+            auto c = points[mesh.second[i + 2]];
+
+            // Make every triangle counter-clockwise
+            float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+            if (area == 0.0f) continue;
+            if (area < 0.0f) std::swap(b, c);
+
+            // Edge function for the edge from p to q. Positive inside a counter-clockwise triangle.
+            auto edge = [](const std::array<float, 2>& p, const std::array<float, 2>& q, const float x, const float y) {
+                return (q[0] - p[0]) * (y - p[1]) - (q[1] - p[1]) * (x - p[0]);
+            };
+            // With y pointing up, going counter-clockwise a top edge runs right to left
+            // and a left edge runs downwards
+            auto topLeft = [](const std::array<float, 2>& p, const std::array<float, 2>& q) {
+                return (p[1] == q[1] && q[0] < p[0]) || q[1] < p[1];
+            };
+            const std::array<std::array<std::array<float, 2>, 2>, 3> edges = {{{a, b}, {b, c}, {c, a}}};
+            std::array<bool, 3> inclusive;
+            for (int e = 0; e < 3; e++) {
+                inclusive[e] = topLeft(edges[e][0], edges[e][1]);
+            }
+
+            // Only visit pixels in the triangle's bounding box
+            const int minX = std::max(0, static_cast<int>(std::floor(std::min({a[0], b[0], c[0]}))));
+            const int maxX = std::min(width - 1, static_cast<int>(std::ceil(std::max({a[0], b[0], c[0]}))));
+            const int minY = std::max(0, static_cast<int>(std::floor(std::min({a[1], b[1], c[1]}))));
+            const int maxY = std::min(height - 1, static_cast<int>(std::ceil(std::max({a[1], b[1], c[1]}))));
+            for (int y = minY; y <= maxY; y++) {
+                const float centerY = y + 0.5f;
+                for (int x = minX; x <= maxX; x++) {
+                    const float centerX = x + 0.5f;
+                    bool inside = true;
+                    for (int e = 0; e < 3 && inside; e++) {
+                        const float w = edge(edges[e][0], edges[e][1], centerX, centerY);
+                        inside = w > 0.0f || (w == 0.0f && inclusive[e]);
+                    }
+                    if (inside) {
+                        unsigned char* pixel = &pixels[(static_cast<size_t>(y) * width + x) * 3];
+                        pixel[0] = TTT::shapeColor[0];
+                        pixel[1] = TTT::shapeColor[1];
+                        pixel[2] = TTT::shapeColor[2];
+                    }
+                }
+            }
+        }
+    }
+    return pixels;
+}
+
+template <int M, int N>
+std::pmr::vector<int> Features::extract(const std::type_identity_t<BasicGrid<M, N>>& grid, std::pmr::memory_resource* memory) {
+    // The pixels are only needed until they're reduced, so they go back to the arena before we return
+    std::pmr::vector<int> features(memory);
+    features.reserve(M * N);
+    Arena::Scope scratch;
+    const auto pixels = rasterize<M, N>(grid, TTT::screenWidth, TTT::screenHeight, scratch.resource());
+    const auto reduced = reduceTile<M, N>(pixels.data(), TTT::screenWidth * 3, TTT::screenWidth, TTT::screenHeight, scratch.resource());
+    features.assign(reduced.begin(), reduced.end());
+    return features;
+}
+
+// The board sizes we build (see the bottom of gameState.cpp)
+template std::pmr::vector<int> Features::reduceTile<3, 3>(const unsigned char*, const int, const int, const int, std::pmr::memory_resource*);
+template std::pmr::vector<int> Features::reduceTile<4, 4>(const unsigned char*, const int, const int, const int, std::pmr::memory_resource*);
+template std::pmr::vector<int> Features::reduceTile<5, 5>(const unsigned char*, const int, const int, const int, std::pmr::memory_resource*);
+template std::pmr::vector<unsigned char> Features::rasterize<3, 3>(const BasicGrid<3, 3>&, const int, const int, std::pmr::memory_resource*);
+template std::pmr::vector<unsigned char> Features::rasterize<4, 4>(const BasicGrid<4, 4>&, const int, const int, std::pmr::memory_resource*);
+template std::pmr::vector<unsigned char> Features::rasterize<5, 5>(const BasicGrid<5, 5>&, const int, const int, std::pmr::memory_resource*);
+template std::pmr::vector<int> Features::extract<3, 3>(const BasicGrid<3, 3>&, std::pmr::memory_resource*);
+template std::pmr::vector<int> Features::extract<4, 4>(const BasicGrid<4, 4>&, std::pmr::memory_resource*);
+template std::pmr::vector<int> Features::extract<5, 5>(const BasicGrid<5, 5>&, std::pmr::memory_resource*);
@@ -0,0 +1,78 @@
+#ifndef BOARD_FEATURES_H
+#define BOARD_FEATURES_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gameState.h"
+
+namespace Features {
+    // Reduce one tile of RGB screen data to the features of a row, one for each of the M x N cells
+    // of the board (9 for the game we play). Like Geometry, other sizes are named, e.g. extract<4, 4>(grid).
+    // rowStride is the number of bytes between the start of two rows, so a tile
+    // can be read straight out of a larger capture (e.g. an atlas).
+    // Like everything here, the result is allocated from memory (e.g. an Arena::Scope's resource) and
+    // the temporaries from this thread's arena, so nothing is allocated once the arena has grown to fit.
+    template <int M = GameState::rows, int N = GameState::cols>
+    std::pmr::vector<int> reduceTile(const unsigned char* data, const int rowStride, const int width, const int height,
+                                     std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+    // Format features and the next move as a CSV row
+    std::string formatRow(const std::span<const int> features, const int move);
+
+    // Averages of the screen at several resolutions, for models that want more than the 9 features of
+    // a row. Every level splits the screen into level x level even blocks, and each block's average
+    // byte is quantized to bits (4 keeps the top nibble like a row's features, 8 keeps all of it).
+    struct Pyramid {
+        std::vector<int> levels;
+        int bits = 4;
+
+        bool enabled() const {return !levels.empty();}
+
+        // Blocks in every level together
+        size_t cells() const;
+    };
+
+    // Parse levels like "3,9,30". Returns false (and prints why) for anything else.
+    bool parsePyramid(const std::string& levels, const int bits, Pyramid& pyramid);
+
+    // Every level of a pyramid from one tile of RGB screen data (bottom row first, like glReadPixels,
+    // with rowStride bytes between rows). The pixels are read once, into an integral image (each entry
+    // the sum of everything above and to the left of it), so any block's sum is 4 lookups whatever its
+    // size. Levels are one after another, each one's blocks row by row from the top left.
+    // The sums are 32 bits, which holds tiles up to about 2300x2300.
+    std::pmr::vector<std::uint8_t> pyramid(const unsigned char* data, const int rowStride, const int width, const int height, const Pyramid& spec,
+                                           std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+    // The board itself and the next move, e.g. "X_C_X____,8": cells row by row as X, C for circle,
+    // or _ for empty. Exported next to every row, so rows can be made again after the features change.
+    std::string formatBoard(const GameState::Grid& grid, const int move);
+
+    // Parse a board written by formatBoard (O is also read as a circle). Returns false if it isn't one.
+    bool parseBoard(const std::string_view line, GameState::Grid& grid, int& move);
+
+    // The file the boards of a log's rows are written to, e.g. out_log.csv -> out_log_boards.csv
+    std::string boardsPath(const std::string& logPath);
+
+    // The binary dataset (see Dataset) written next to a log when a pyramid is captured, e.g. out_log.csv -> out_log.tttset
+    std::string datasetPath(const std::string& logPath);
+
+    // Draw a board on the CPU, exactly as the renderer would draw it to the screen,
+    // and return the RGB pixels bottom row first (like glReadPixels).
+    // This lets us compute features without an OpenGL context.
+    template <int M = GameState::rows, int N = GameState::cols>
+    std::pmr::vector<unsigned char> rasterize(const std::type_identity_t<BasicGrid<M, N>>& grid, const int width, const int height,
+                                              std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+    // Compute the features of a board without an OpenGL context. Matches what
+    // CSVHandler::generateRowData captures from the screen for the same board,
+    // except for pixels right on the edge of a shape where rasterizers may disagree.
+    template <int M = GameState::rows, int N = GameState::cols>
+    std::pmr::vector<int> extract(const std::type_identity_t<BasicGrid<M, N>>& grid, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+}
+
+#endif
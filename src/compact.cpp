@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Compact the training log: every identical row (same features, same move) becomes a single
+// row with a count of how many times it was seen. The log is streamed once, in large blocks,
+// and rows are counted in an open-addressing hash table keyed by the row packed into 40 bits.
+//
+// Compaction is incremental. The byte offset of the end of the last complete row we read is
+// kept in a state file next to the output, with a hash of the log up to there, so the next run
+// loads the compacted rows, only reads what has been appended to the log since, and rewrites
+// the output. If the log before that offset has changed (it was replaced or rotated), it starts over.
+// The state also holds the size and hash of the output it goes with, so an output that doesn't match
+// (e.g. a run was killed between replacing the output and writing the state) isn't counted twice.
+
+namespace {
+    constexpr size_t blockSize = 1 << 20; // Bytes read from the log at a time
+    constexpr std::uint32_t emptySlot = 0xFFFFFFFF;
+
+    // A row packed into an integer: 4 bits per feature (each is a single hex digit) then the move
+    using RowKey = std::uint64_t;
+
+    struct Entry {
+        RowKey key;
+        std::uint64_t count;
+    };
+
+    class RowCounter {
+        // Open addressing with linear probing. Slots hold an index into entries, so the table
+        // itself is 4 bytes a slot, and entries stay in the order rows were first seen, which
+        // keeps the output stable between incremental runs.
+        public:
+            RowCounter() : slots(1024, emptySlot) {}
+
+            void add(const RowKey key, const std::uint64_t count) {
+                // Grow before the table is half full so probes stay short
+                if ((entries.size() + 1) * 2 > slots.size()) {
+                    grow();
+                }
+                size_t slot = find(key);
+                if (slots[slot] == emptySlot) {
+                    slots[slot] = static_cast<std::uint32_t>(entries.size());
+                    entries.push_back({key, 0});
+                }
+                entries[slots[slot]].count += count;
+            }
+
+            const std::vector<Entry>& getEntries() const {return entries;}
+
+        private:
+            // splitmix64's finalizer, packed rows are far from random
+            static std::uint64_t hash(RowKey key) {
+                key ^= key >> 30;
+                key *= 0xBF58476D1CE4E5B9ULL;
+                key ^= key >> 27;
+                key *= 0x94D049BB133111EBULL;
+                key ^= key >> 31;
+                return key;
+            }
+
+            // The slot holding key, or the empty slot where it belongs
+            size_t find(const RowKey key) const {
+                const size_t mask = slots.size() - 1;
+                size_t slot = hash(key) & mask;
+                while (slots[slot] != emptySlot && entries[slots[slot]].key != key) {
+                    slot = (slot + 1) & mask;
+                }
+                return slot;
+            }
+
+            void grow() {
+                slots.assign(slots.size() * 2, emptySlot);
+                for (size_t i = 0; i < entries.size(); i++) {
+                    slots[find(entries[i].key)] = static_cast<std::uint32_t>(i);
+                }
+            }
+
+            std::vector<std::uint32_t> slots;
+            std::vector<Entry> entries;
+    };
+
+    // 64 bit FNV-1a, to fingerprint the part of the log already compacted
+    constexpr std::uint64_t hashStart = 0xCBF29CE484222325ULL;
+
+    std::uint64_t hashBytes(std::uint64_t hash, const char* begin, const char* end) {
+        for (const char* c = begin; c < end; c++) {
+            hash = (hash ^ static_cast<unsigned char>(*c)) * 0x100000001B3ULL;
+        }
+        return hash;
+    }
+
+    // The hash of the first length bytes of a file. Returns false if it's shorter than that.
+    bool hashPrefix(const std::string& path, std::uint64_t length, std::uint64_t& hash) {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<char> block(blockSize);
+        hash = hashStart;
+        while (length > 0 && file) {
+            file.read(block.data(), static_cast<std::streamsize>(std::min<std::uint64_t>(block.size(), length)));
+            const size_t bytesRead = static_cast<size_t>(file.gcount());
+            hash = hashBytes(hash, block.data(), block.data() + bytesRead);
+            length -= bytesRead;
+        }
+        return length == 0;
+    }
+
+    // Parse one hex digit, or return -1
+    int hexDigit(const char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Pack "f1,...,f9,move" (and optionally ",count") into a key.
+    // Returns false for anything else, like the header.
+    bool parseRow(const char* begin, const char* end, RowKey& key, std::uint64_t& count) {
+        key = 0;
+        const char* c = begin;
+        for (int feature = 0; feature < 9; feature++) {
+            if (c + 1 >= end || hexDigit(*c) < 0 || c[1] != ',') {
+                return false;
+            }
+            key = (key << 4) | static_cast<RowKey>(hexDigit(*c));
+            c += 2;
+        }
+        if (c >= end || *c < '0' || *c > '8') {
+            return false;
+        }
+        key = (key << 4) | static_cast<RowKey>(*c - '0');
+        c++;
+
+        // Compacted rows carry their count
+        count = 1;
+        if (c < end && *c == ',') {
+            count = 0;
+            for (c++; c < end && *c >= '0' && *c <= '9'; c++) {
+                count = count * 10 + static_cast<std::uint64_t>(*c - '0');
+            }
+        }
+        while (c < end && (*c == '\r' || *c == ' ')) c++;
+        return c == end;
+    }
+
+    // Read rows from a file starting at offset, adding them to counter. Only complete lines
+    // are read; returns the offset just after the last one. hash is carried on over every byte read.
+    std::uint64_t readRows(const std::string& path, const std::uint64_t offset, RowCounter& counter, size_t& rows, size_t& skipped, std::uint64_t& hash) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return offset;
+        }
+        file.seekg(static_cast<std::streamoff>(offset));
+
+        std::vector<char> block(blockSize);
+        std::string carry; // A partial line left over from the previous block
+        std::uint64_t consumed = offset;
+        while (file) {
+            file.read(block.data(), static_cast<std::streamsize>(block.size()));
+            const size_t bytesRead = static_cast<size_t>(file.gcount());
+            if (bytesRead == 0) {
+                break;
+            }
+
+            const char* data = block.data();
+            const char* end = data + bytesRead;
+            const char* lineStart = data;
+            for (const char* c = data; c < end; c++) {
+                if (*c != '\n') {
+                    continue;
+                }
+                RowKey key;
+                std::uint64_t count;
+                bool parsed;
+                if (!carry.empty()) {
+                    hash = hashBytes(hash, carry.data(), carry.data() + carry.size());
+                    carry.append(lineStart, c);
+                    parsed = parseRow(carry.data(), carry.data() + carry.size(), key, count);
+                    consumed += carry.size() + 1;
+                    carry.clear();
+                } else {
+                    parsed = parseRow(lineStart, c, key, count);
+                    consumed += static_cast<std::uint64_t>(c - lineStart) + 1;
+                }
+                if (parsed) {
+                    counter.add(key, count);
+                    rows++;
+                } else if (c != lineStart) {
+                    skipped++;
+                }
+                lineStart = c + 1;
+            }
+            hash = hashBytes(hash, data, lineStart);
+            carry.append(lineStart, end);
+        }
+        // Anything left in carry is a row still being written, it'll be read next time
+        return consumed;
+    }
+
+    void writeRow(std::ofstream& out, const Entry& entry) {
+        static const char digits[] = "0123456789abcdef";
+        char row[20];
+        for (int feature = 0; feature < 9; feature++) {
+            row[feature * 2] = digits[(entry.key >> (4 * (9 - feature))) & 0xF];
+            row[feature * 2 + 1] = ',';
+        }
+        row[18] = static_cast<char>('0' + (entry.key & 0xF));
+        row[19] = ',';
+        out.write(row, sizeof(row));
+        out << entry.count << '\n';
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Parse command line flags
+    std::string inPath = std::filesystem::path(CSV_PATH).string() + "/out_log.csv";
+    std::string outPath;
+    bool full = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--in" && i + 1 < argc) {
+            inPath = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (arg == "--full") {
+            full = true;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: compact [--in FILE] [--out FILE] [--full]" << std::endl;
+            return -1;
+        }
+    }
+    if (outPath.empty()) {
+        outPath = std::filesystem::path(inPath).replace_extension("").string() + "_compact.csv";
+    }
+    const std::string statePath = outPath + ".state";
+
+    if (!std::filesystem::exists(inPath)) {
+        std::cerr << "ERROR::COMPACT::NO_INPUT " << inPath << std::endl;
+        return -1;
+    }
+    const std::uint64_t inSize = std::filesystem::file_size(inPath);
+
+    // Pick up where the last run stopped, unless the log has been replaced since or the output isn't the one the state is for
+    std::uint64_t offset = 0;
+    std::uint64_t hash = hashStart;
+    if (!full && std::filesystem::exists(outPath)) {
+        std::ifstream state(statePath);
+        std::uint64_t savedHash = 0;
+        std::uint64_t outSize = 0;
+        std::uint64_t savedOutHash = 0;
+        std::uint64_t outHash = hashStart;
+        state >> offset >> savedHash >> outSize >> savedOutHash;
+        std::error_code error;
+        if (!state || offset > inSize) {
+            offset = 0;
+        } else if (std::filesystem::file_size(outPath, error) != outSize || !hashPrefix(outPath, outSize, outHash) || outHash != savedOutHash) {
+            std::cout << "The output doesn't match the last run's state, compacting the log from the start" << std::endl;
+            offset = 0;
+        } else if (!hashPrefix(inPath, offset, hash) || hash != savedHash) {
+            std::cout << "The log has changed since the last run, compacting it from the start" << std::endl;
+            offset = 0;
+            hash = hashStart;
+        }
+    }
+
+    RowCounter counter;
+    size_t rows = 0;
+    size_t skipped = 0;
+    if (offset > 0) {
+        size_t previousRows = 0;
+        size_t previousSkipped = 0; // The header
+        std::uint64_t outHash = hashStart;
+        readRows(outPath, 0, counter, previousRows, previousSkipped, outHash);
+        std::cout << "Loaded " << counter.getEntries().size() << " compacted rows, resuming at byte " << offset << std::endl;
+    }
+    const std::uint64_t consumed = readRows(inPath, offset, counter, rows, skipped, hash);
+
+    // Write to a temporary file and swap it in, so a crash never leaves a half written output
+    const std::string tempPath = outPath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "ERROR::COMPACT::CANNOT_OPEN " << tempPath << std::endl;
+            return -1;
+        }
+        out << "1,2,3,4,5,6,7,8,9,next_move,count\n";
+        for (const auto& entry : counter.getEntries()) {
+            writeRow(out, entry);
+        }
+    }
+    const std::uint64_t outSize = std::filesystem::file_size(tempPath);
+    std::uint64_t outHash = hashStart;
+    hashPrefix(tempPath, outSize, outHash);
+    std::error_code error;
+    std::filesystem::rename(tempPath, outPath, error);
+    if (error) {
+        std::cerr << "ERROR::COMPACT::CANNOT_REPLACE " << outPath << " --> " << error.message() << std::endl;
+        return -1;
+    }
+    std::ofstream(statePath, std::ios::trunc) << consumed << ' ' << hash << ' ' << outSize << ' ' << outHash << '\n';
+
+    std::cout << "Read " << rows << " new rows (" << (consumed - offset) << " bytes, " << skipped << " skipped lines) from " << inPath << std::endl;
+    std::cout << "Wrote " << counter.getEntries().size() << " distinct rows to " << outPath << std::endl;
+    return 0;
+}
@@ -1,6 +1,8 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <array>
+#include <cstddef>
 #include <filesystem>
 #include <string>
 
@@ -8,8 +10,33 @@ namespace TTT {
     const std::filesystem::path shaderSourceDir = SHADER_PATH;
     const std::string vertexShaderPath = shaderSourceDir.string() + "/vertexShader.glsl";
     const std::string fragmentShaderPath = shaderSourceDir.string() + "/fragmentShader.glsl";
+    const std::filesystem::path shaderCacheDir = SHADER_CACHE_PATH;
     constexpr int screenWidth = 600;
     constexpr int screenHeight = 600;
     constexpr float lineWidth = 0.05f;
+    constexpr std::array<unsigned char, 3> shapeColor = {255, 128, 51}; // What fragmentShader.glsl's color ends up as in the framebuffer
+    constexpr int circleSegments = 64; // Segments in the circle glyph. It's only built once, so this is free per move.
+    constexpr int atlasMaxSize = 8192; // Upper bound on either dimension of the atlas framebuffer
+#ifdef _WIN32
+    const std::string pythonCommand = "python";
+#else
+    const std::string pythonCommand = "python3";
+#endif
+    const std::string modelCommand = pythonCommand + " " + std::string(MODEL_PATH) + " " + std::string(CSV_PATH) + "/out_log.csv";
+    const std::string nativeModelPath = std::string(CSV_PATH) + "/out_log_weights.txt"; // Written by model.py with its checkpoint of out_log.csv
+    const std::string sessionLogDir = std::string(CSV_PATH) + "/sessions"; // Every windowed session's events, for main --replay
+    const std::string replayOutPath = std::string(CSV_PATH) + "/replay.csv"; // Where replays export rows, so they don't end up in the training log twice
+    constexpr int modelStartTimeoutMs = 300000; // The model trains before it's ready, so give it a while
+    constexpr int modelReplyTimeoutMs = 10000;
+    constexpr int modelMaxAttempts = 20; // Illegal moves we ask the model to try again for, before playing a random move
+    constexpr int modelHeartbeatIntervalMs = 2000; // An idle model is pinged this often...
+    constexpr int modelHeartbeatTimeoutMs = 2000; // ...and restarted if it doesn't answer in time
+    constexpr int modelRestartMinMs = 250; // Wait before restarting a model, doubling after every failure
+    constexpr int modelRestartMaxMs = 30000;
+    constexpr int mctsBudgetMs = 200; // How long Monte Carlo tree search thinks about a move by default
+    constexpr int mctsMaxNodes = 1 << 19; // Nodes in each engine's tree arena (16 bytes each)
+    constexpr int mctsVirtualLoss = 3; // Visits a thread adds to its path while it's still playing it out
+    constexpr double mctsExploration = 1.41421356; // UCT's exploration constant, sqrt(2)
+    constexpr size_t arenaBytes = 1 << 16; // What each thread's arena starts with. It grows to fit the most a game has needed at once.
 };
 #endif
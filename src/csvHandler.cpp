@@ -1,114 +1,246 @@
 #include "glad/glad.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <exception>
 #include <array>
 #include <vector>
+#include <sstream>
+#include <filesystem>
 
 #include "csvHandler.h"
+#include "arena.h"
 #include "constants.h"
+#include "boardFeatures.h"
+#include "profiler.h"
+#include "symmetry.h"
 
-std::string CSVHandler::generateRowData(const int move) {
-    // Read our screen data from OpenGL
+namespace {
+    // Symmetry::key of a grid
+    std::uint32_t gridKey(const GameState::Grid& grid) {
+        GameState::Bitboard xBits = 0;
+        GameState::Bitboard circleBits = 0;
+        for (int cell = 0; cell < GameState::cells; cell++) {
+            const GameState::CellState state = grid[cell / GameState::cols][cell % GameState::cols];
+            xBits |= static_cast<GameState::Bitboard>(state == GameState::X) << cell;
+            circleBits |= static_cast<GameState::Bitboard>(state == GameState::CIRCLE) << cell;
+        }
+        return Symmetry::key(xBits, circleBits);
+    }
+}
+
+bool CSVHandler::captureFeatures(Capture& capture) {
+    // Read our screen data from OpenGL, into this thread's arena (it's given back when we return)
     constexpr int bufSize = TTT::screenWidth * TTT::screenHeight * 3; // 3 bytes for GL_RGB
-    GLubyte *data = static_cast<GLubyte*>(malloc(bufSize));
-    if (!data) return "FAILURE";
-    glReadPixels(0, 0, TTT::screenWidth, TTT::screenHeight, GL_RGB, GL_UNSIGNED_BYTE, data);
-
-    // Each row of pixels has TTT::screenWidth * 3 bytes. Each row has TTT::screenWidth pixels. So, for 600x600 resolution, we have 1800 bytes per row. We have 600 rows. So in total, we're dealing with ~1M bytes.
-    // To reduce our data, we average every pixel together, which reduces us to 600 bytes per row for example. Now, we're dealing with a 600x600 grid. This is still far too large, so we will average every 200x200
-    // area together. This would reduce our total output feature space to 9 dimensions.
-    // Since we know we're only working with a 600x600 pixel grid, we will hardcode that assumption.
-
-    // Practically, this means that in every row we average each 600 bytes (200 pixels) into 1 byte. This should yield 3 bytes per row. We then inspect the value of each byte and clamp it to the range [0-15] so we can use it as HEX.
-    // So, we should get 3 HEX characters per row. Then, we avaerage the first 200 rows in each column, then the 2nd 200 rows, then the 3rd 200, in each column (clamping the same), to yield a 3x3 grid of 9 HEX characters after every move.
-
-    // Output stream
-    std::stringstream temp;
-    temp << std::hex; // set to hex output
-    
-    // handle row reducing
-    std::vector<int> rowResults;
-    for (int row = 0; row < TTT::screenHeight; ++row) {
-        for (int j = 0; j < 3; j++) {
-            int sum = 0;
-            // Each row is 1800 bytes long, average every 600 bytes (200 pixels * 3 bytes per pixel). 
-            // Iterate through the rows by multiplying the current row number by the length of each row.
-            // j corresponds to which third we're averaging in the row.
-            int offset = row * TTT::screenWidth * 3;
-            for (int i = 0; i < 600; i++) {
-                sum += static_cast<int>(data[offset + i + j * 600]);
+    Arena::Scope scratch;
+    std::pmr::vector<GLubyte> data(bufSize, scratch.resource());
+    glReadPixels(0, 0, TTT::screenWidth, TTT::screenHeight, GL_RGB, GL_UNSIGNED_BYTE, data.data());
+
+    // Since we know we're only working with a 600x600 pixel grid, the whole screen is a single tile.
+    const auto reduced = Features::reduceTile(data.data(), TTT::screenWidth * 3, TTT::screenWidth, TTT::screenHeight, scratch.resource());
+
+    if (reduced.size() != GameState::cells) {
+        std::cerr << "Incorrect col reduction." << std::endl;
+        return false;
+    }
+    std::copy(reduced.begin(), reduced.end(), capture.features.begin());
+
+    // The pyramid comes from the same pixels
+    capture.pyramid.clear();
+    if (pyramid.enabled()) {
+        const auto levels = Features::pyramid(data.data(), TTT::screenWidth * 3, TTT::screenWidth, TTT::screenHeight, pyramid, scratch.resource());
+        capture.pyramid.assign(levels.begin(), levels.end());
+    }
+    return true;
+}
+
+const CSVHandler::Capture* CSVHandler::screenCapture(const GameState& game) {
+    const std::uint32_t key = Symmetry::key(game.getBits(GameState::X), game.getBits(GameState::CIRCLE))
+        | static_cast<std::uint32_t>(wireframe) << 18;
+
+    // A board we've seen before, checked against the screen every so often if asked to
+    const auto found = featureCache.find(key);
+    if (found != featureCache.end()) {
+        cacheHits++;
+        if (validateEvery > 0 && cacheHits % validateEvery == 0) {
+            Capture fresh;
+            if (captureFeatures(fresh)) {
+                cacheValidated++;
+                if (fresh != found->second) {
+                    cacheDrifted++;
+                    std::cerr << "ERROR::CSV::FEATURE_CACHE_DRIFT cached " << Features::formatRow(found->second.features, -1)
+                              << ", screen " << Features::formatRow(fresh.features, -1)
+                              << (fresh.pyramid != found->second.pyramid ? " (pyramid differs)" : "") << std::endl;
+                    found->second = std::move(fresh);
+                }
             }
-            sum /= 600; // divide by 600 to get within the range 0 - 255
-            rowResults.push_back(sum);
         }
+        return &found->second;
     }
-    if (rowResults.size() != 1800) {
-        std::cerr << "Incorrect row reduction." << std::endl;
-        return "FAILURE";
-    }
-
-    // handle column reduction
-    std::vector<int> colResults;
-    for (int col = 0; col < 3; col++) {
-        std::array<int, 3> sums = {0, 0, 0};
-        
-        // Iterate over each column
-        for (int i = 0; i < 600; i++) {
-            int index = i * 3 + col; // Index is column offset + the current i value * 3 since we have 1800 total values
-            if (index < 200) sums[0] += rowResults[index]; // If in the first 3rd, add to 1st sum
-            else if (index < 400) sums[1] += rowResults[index]; // 2nd
-            else sums[2] += rowResults[index]; // 3rd
-        }
 
-        for (auto s : sums) {
-            colResults.push_back(s / 200);
-        }
+    cacheMisses++;
+    Capture capture;
+    if (!captureFeatures(capture)) {
+        return nullptr;
     }
-    if (colResults.size() != 9) {
-        std::cerr << "Incorrect col reduction." << std::endl;
-        return "FAILURE";
+    return &featureCache.emplace(key, std::move(capture)).first->second;
+}
+
+std::string CSVHandler::generateRowData(const GameState& game, const int move) {
+    ScopeTimer timer("generateRowData");
+    const Capture* capture = screenCapture(game);
+    return capture ? Features::formatRow(capture->features, move) : "FAILURE";
+}
+
+bool CSVHandler::setPyramid(const Features::Pyramid& spec) {
+    featureCache.clear();
+    cpuCaptures.clear();
+    pyramid = Features::Pyramid();
+    dataset.close();
+    if (!spec.enabled()) {
+        return true;
+    }
+    if (!dataset.open(Features::datasetPath(getLogPath()), spec)) {
+        return false;
     }
+    pyramid = spec;
+    return true;
+}
 
-    // adjust column values so they're in the range 0-15
-    for (auto iter = colResults.begin(); iter != colResults.end(); iter++) {
-        *iter /= 16;
+void CSVHandler::printCacheStats(std::ostream& out) const {
+    out << "Feature cache: " << cacheHits << " hits, " << cacheMisses << " misses, " << featureCache.size() << " boards";
+    if (validateEvery > 0) {
+        out << ", " << cacheValidated << " hits checked against the screen, " << cacheDrifted << " drifted";
     }
-    
-    // Output the move's information as a row to the output log
-    for (auto val : colResults) {
-        temp << val << ",";
-    } temp << std::dec << move; // output the move in decimal
-    
-    // Write to our output string
-    std::string result(temp.str());
+    out << std::endl;
+}
 
-    // Free the screen data
-    free(data);
+std::vector<std::string> CSVHandler::generateAtlasRowData(const std::vector<int>& moves, const int tileSize, const int columns, const int rows) {
+    // A single readback for the whole atlas. Tile (0, 0) is the top left tile, but OpenGL
+    // returns rows bottom to top, so the top row of tiles is at the end of the buffer.
+    const int atlasWidth = tileSize * columns;
+    const int atlasHeight = tileSize * rows;
+    std::vector<GLubyte> data(static_cast<size_t>(atlasWidth) * atlasHeight * 3);
+    glPixelStorei(GL_PACK_ROW_LENGTH, atlasWidth);
+    glReadPixels(0, 0, atlasWidth, atlasHeight, GL_RGB, GL_UNSIGNED_BYTE, data.data());
+    glPixelStorei(GL_PACK_ROW_LENGTH, TTT::screenWidth); // Back to the default used for screen captures
 
-    // Return
-    return result;
+    // Reduce every tile in place, walking the tiles with the atlas row stride
+    std::vector<std::string> results;
+    results.reserve(moves.size());
+    const int rowStride = atlasWidth * 3;
+    for (size_t tile = 0; tile < moves.size(); tile++) {
+        const int col = static_cast<int>(tile) % columns;
+        const int row = rows - 1 - static_cast<int>(tile) / columns;
+        const GLubyte* tileData = data.data() + static_cast<size_t>(row) * tileSize * rowStride + col * tileSize * 3;
+        results.push_back(Features::formatRow(Features::reduceTile(tileData, rowStride, tileSize, tileSize), moves[tile]));
+    }
+    return results;
 }
 
-void CSVHandler::exportMove(const int move) {
-    std::string outPath = std::filesystem::path(CSV_PATH).string() + "/out_log.csv";
+const CSVHandler::CpuCapture& CSVHandler::cpuCapture(const GameState::Grid& grid) {
+    const std::uint32_t key = gridKey(grid);
+    auto found = cpuCaptures.find(key);
+    if (found == cpuCaptures.end()) {
+        // Draw the board once for both the row and the pyramid, the same way Features::extract does.
+        // formatRow ends with the move, so format it without one and keep everything up to the last comma.
+        Arena::Scope scratch;
+        const auto pixels = Features::rasterize(grid, TTT::screenWidth, TTT::screenHeight, scratch.resource());
+        CpuCapture capture;
+        capture.row = Features::formatRow(Features::reduceTile(pixels.data(), TTT::screenWidth * 3, TTT::screenWidth, TTT::screenHeight, scratch.resource()), -1);
+        capture.row.erase(capture.row.rfind(',') + 1);
+        if (pyramid.enabled()) {
+            const auto levels = Features::pyramid(pixels.data(), TTT::screenWidth * 3, TTT::screenWidth, TTT::screenHeight, pyramid, scratch.resource());
+            capture.pyramid.assign(levels.begin(), levels.end());
+        }
+        found = cpuCaptures.emplace(key, std::move(capture)).first;
+    }
+    return found->second;
+}
 
-    std::ofstream file;
+std::string CSVHandler::getLogPath() const {
+    return logPath.empty() ? std::filesystem::path(CSV_PATH).string() + "/out_log.csv" : logPath;
+}
+
+bool CSVHandler::openLog(std::ofstream& file, const std::string& outPath) {
     file.exceptions(file.exceptions() | std::ios::failbit);
     try {
         file.open(outPath.c_str(), std::ios::app);
     } catch (std::exception e) {
         std::cerr << "Unable to open CSV log file: " << outPath << " --> " << e.what() << std::endl;
-        return;
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> CSVHandler::exportMove(const int move, const GameState& game) {
+    std::vector<std::string> rows;
+    std::ofstream file;
+    std::ofstream boardFile;
+    if (!openLog(file, getLogPath()) || !openLog(boardFile, Features::boardsPath(getLogPath()))) {
+        return rows;
+    }
+
+    // Write to our output file, the board it came from to the boards file, and its pyramid to the dataset
+    const GameState::Grid grid = game.getGrid();
+    if (cpuFeatures) {
+        const CpuCapture& capture = cpuCapture(grid);
+        rows.push_back(capture.row + std::to_string(move));
+        dataset.append(gridKey(grid), move, capture.pyramid);
+    } else if (const Capture* capture = screenCapture(game)) {
+        rows.push_back(Features::formatRow(capture->features, move));
+        dataset.append(gridKey(grid), move, capture->pyramid);
     }
+    if (!rows.empty()) {
+           file << rows.back() << std::endl;
+           boardFile << Features::formatBoard(grid, move) << '\n';
+    }
+
+    // Then every other distinct symmetry of the board (variant 0 is the row we just wrote),
+    // drawn on the CPU once per board
+    if (augment) {
+        Arena::Scope scratch;
+        const auto variants = Symmetry::distinctVariants(grid, move, scratch.resource());
+        for (size_t i = 1; i < variants.size(); i++) {
+            const int s = variants[i];
+            const GameState::Grid variant = Symmetry::mapGrid(s, grid);
+            const int variantMove = Symmetry::mapCell(s, move);
+            const CpuCapture& capture = cpuCapture(variant);
+            rows.push_back(capture.row + std::to_string(variantMove));
+            file << rows.back() << std::endl;
+            boardFile << Features::formatBoard(variant, variantMove) << '\n';
+            dataset.append(gridKey(variant), variantMove, capture.pyramid);
+        }
+    }
+
+    file.close();
+    boardFile.close();
+    dataset.flush();
+    return rows;
+}
 
-    // Write to our output file
-    std::string result = generateRowData(move);
-    if (result != "FAILURE") {
-           file << result << std::endl;
+void CSVHandler::exportRows(const std::vector<std::string>& rows, const std::vector<std::string>& boards) {
+    std::ofstream file;
+    std::ofstream boardFile;
+    if (!openLog(file, getLogPath()) || !openLog(boardFile, Features::boardsPath(getLogPath()))) {
+        return;
     }
 
+    // Write every row in one go, and then every board
+    std::string out;
+    for (const auto& row : rows) {
+        out += row;
+        out += '\n';
+    }
+    file << out;
+    out.clear();
+    for (const auto& board : boards) {
+        out += board;
+        out += '\n';
+    }
+    boardFile << out;
     file.close();
-}
\ No newline at end of file
+    boardFile.close();
+}
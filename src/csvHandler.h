@@ -1,12 +1,117 @@
 #ifndef CSV_HANDLER
 #define CSV_HANDLER
 
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "boardFeatures.h"
+#include "dataset.h"
+#include "gameState.h"
 
 class CSVHandler {
     public:
-        std::string generateRowData(const int move);
-        void exportMove(const int move);
+        // The row for the board on screen and the next move. The features of every board captured
+        // are cached (see featureCache below), so a board seen before isn't read back again.
+        std::string generateRowData(const GameState& game, const int move);
+
+        // Export the screen data for the board the game is showing, and the next move.
+        // The board itself is written to the log's boards file (see Features::boardsPath) too, and
+        // with a pyramid set, a record of it to the log's dataset (see Features::datasetPath).
+        // With augmentation on, a row for every distinct rotation and reflection of the board is
+        // exported too (see Symmetry). Those boards aren't on screen, so they're drawn on the CPU
+        // by Features::extract, which gives the same features as the screen (unless it's in wireframe).
+        // Returns the rows that were written.
+        std::vector<std::string> exportMove(const int move, const GameState& game);
+
+        // Turn 8-fold augmentation of exported moves on or off
+        void setAugment(const bool enabled) {augment = enabled;}
+
+        // Draw exported boards on the CPU (Features::extract) instead of reading the screen, for when
+        // there is no screen (replays). Each distinct board is only drawn once, as augmented boards are.
+        void setCpuFeatures(const bool enabled) {cpuFeatures = enabled;}
+
+        // Tell the cache the screen is (or isn't) in wireframe, which changes every board's features
+        void setWireframe(const bool enabled) {wireframe = enabled;}
+
+        // Forget every board captured from the screen, e.g. once the shaders have been reloaded
+        void clearFeatureCache() {featureCache.clear();}
+
+        // Every n-th cache hit, read the screen back anyway and check it still matches (0 never checks)
+        void setCacheValidation(const int every) {validateEvery = every;}
+
+        // Capture a feature pyramid from every exported board as well as its row (disabled by default),
+        // into the log's dataset, which is opened here (so set the log path first). Returns false (and
+        // leaves the pyramid off) if the dataset can't be opened or holds a different pyramid, so the
+        // rows, boards and pyramids of a log always line up. Boards captured before don't have a
+        // pyramid, so the caches are emptied.
+        bool setPyramid(const Features::Pyramid& spec);
+
+        // Hits, misses, and for validation how many hits were checked and how many had drifted
+        void printCacheStats(std::ostream& out) const;
+
+        // Append rows to another file instead of the training log
+        void setLogPath(const std::string& path) {logPath = path;}
+        std::string getLogPath() const;
+
+        // Read back an atlas of board tiles (see Renderer::drawAtlas) in one go and
+        // generate a row for each tile. Tiles are numbered left to right, top to bottom,
+        // and moves[i] is the next move for tile i.
+        std::vector<std::string> generateAtlasRowData(const std::vector<int>& moves, const int tileSize, const int columns, const int rows);
+
+        // Append already generated rows to the output log, and the boards they came from
+        // (see Features::formatBoard) to its boards file
+        void exportRows(const std::vector<std::string>& rows, const std::vector<std::string>& boards);
+
+    private:
+        bool augment = false;
+        bool cpuFeatures = false;
+        bool wireframe = false;
+        std::string logPath;
+        Features::Pyramid pyramid;
+        Dataset dataset;
+
+        // What a board looks like: its row's features and, with a pyramid set, the pyramid
+        struct Capture {
+            std::array<int, GameState::cells> features;
+            std::vector<std::uint8_t> pyramid;
+
+            bool operator==(const Capture&) const = default;
+        };
+
+        // The captures from the screen for every board seen so far. A board's features only
+        // depend on what's drawn, so the key is the board (Symmetry::key, 18 bits) and whether it's in
+        // wireframe (bit 18). The capture is always the whole screen, and the cache is emptied when the
+        // shaders change (clearFeatureCache). Boards are only captured while the game is on, so the win
+        // line is never part of it.
+        std::unordered_map<std::uint32_t, Capture> featureCache;
+        int validateEvery = 0;
+        std::uint64_t cacheHits = 0;
+        std::uint64_t cacheMisses = 0;
+        std::uint64_t cacheValidated = 0;
+        std::uint64_t cacheDrifted = 0;
+
+        // Read the screen back once and reduce it to features and the pyramid. Returns false if the reduction went wrong.
+        bool captureFeatures(Capture& capture);
+
+        // The capture of the board on screen, from the cache if it's been seen. nullptr if the capture failed.
+        const Capture* screenCapture(const GameState& game);
+
+        // A board drawn on the CPU. Every board drawn so far is kept by Symmetry::key, with its row
+        // formatted up to the move.
+        struct CpuCapture {
+            std::string row;
+            std::vector<std::uint8_t> pyramid;
+        };
+        const CpuCapture& cpuCapture(const GameState::Grid& grid);
+        std::unordered_map<std::uint32_t, CpuCapture> cpuCaptures;
+
+        // Open an output file for appending
+        bool openLog(std::ofstream& file, const std::string& outPath);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+
+#include "dataset.h"
+
+namespace {
+    constexpr char magic[] = "TTTSET";
+    constexpr int magicLength = 6;
+    constexpr std::uint8_t version = 1;
+
+    template <typename T>
+    void putLittle(std::string& out, const T value) {
+        for (size_t i = 0; i < sizeof(T); i++) {
+            out.push_back(static_cast<char>((static_cast<std::uint64_t>(value) >> (8 * i)) & 0xff));
+        }
+    }
+
+    std::string header(const Features::Pyramid& spec) {
+        std::string out(magic, magicLength);
+        putLittle<std::uint8_t>(out, version);
+        putLittle<std::uint8_t>(out, static_cast<std::uint8_t>(spec.bits));
+        putLittle<std::uint8_t>(out, static_cast<std::uint8_t>(spec.levels.size()));
+        for (const int level : spec.levels) {
+            putLittle<std::uint16_t>(out, static_cast<std::uint16_t>(level));
+        }
+        putLittle<std::uint32_t>(out, static_cast<std::uint32_t>(Dataset::recordBytes(spec)));
+        return out;
+    }
+}
+
+size_t Dataset::recordBytes(const Features::Pyramid& spec) {
+    return 5 + (spec.cells() * spec.bits + 7) / 8;
+}
+
+bool Dataset::open(const std::string& path, const Features::Pyramid& spec) {
+    close();
+    const std::string expected = header(spec);
+
+    // Appending to a dataset of another pyramid would make every record after it unreadable
+    std::error_code error;
+    if (std::filesystem::exists(path, error) && std::filesystem::file_size(path, error) > 0) {
+        std::ifstream existing(path, std::ios::binary);
+        std::string found(expected.size(), '\0');
+        existing.read(found.data(), static_cast<std::streamsize>(found.size()));
+        if (found != expected) {
+            std::cerr << "ERROR::DATASET::DIFFERENT_PYRAMID " << path << " was written with other levels or bits" << std::endl;
+            return false;
+        }
+        file.open(path, std::ios::binary | std::ios::app);
+    } else {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        file << expected;
+    }
+    if (!file) {
+        std::cerr << "ERROR::DATASET::CANNOT_OPEN " << path << std::endl;
+        return false;
+    }
+    pyramid = spec;
+    record.reserve(recordBytes(spec));
+    return true;
+}
+
+void Dataset::append(const std::uint32_t board, const int move, const std::span<const std::uint8_t> features) {
+    if (!isOpen() || features.size() != pyramid.cells()) {
+        return;
+    }
+    record.clear();
+    putLittle<std::uint32_t>(record, board);
+    putLittle<std::uint8_t>(record, static_cast<std::uint8_t>(move));
+    if (pyramid.bits == 8) {
+        record.append(reinterpret_cast<const char*>(features.data()), features.size());
+    } else {
+        for (size_t i = 0; i < features.size(); i += 2) {
+            const std::uint8_t high = i + 1 < features.size() ? features[i + 1] : 0;
+            record.push_back(static_cast<char>((features[i] & 0xf) | (high & 0xf) << 4));
+        }
+    }
+    file.write(record.data(), static_cast<std::streamsize>(record.size()));
+}
@@ -0,0 +1,45 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+
+#include "boardFeatures.h"
+
+class Dataset {
+    // A binary training set of feature pyramids (see Features::Pyramid), written next to the CSV log
+    // when one is captured. Every record is the same size, so it can be read straight into an array
+    // (rowparse.read_dataset does for model.py). The file starts with a header:
+    //   "TTTSET", version (1 byte), bits per feature (1 byte, 4 or 8), number of levels (1 byte),
+    //   every level's size (2 bytes each), and the size of a record in bytes (4 bytes)
+    // followed by the records:
+    //   the board (4 bytes, Symmetry::key: X's cells, then circle's 9 bits up), the next move (1 byte),
+    //   then every feature of every level. With 4 bits, two features share a byte, the first in the low
+    //   nibble, and an odd count leaves the last high nibble empty.
+    // Numbers are little endian.
+    public:
+        // Open a dataset for appending (closing any other), writing the header if it's new. Returns false (and prints why)
+        // if it can't be written, or if it already holds a different pyramid.
+        bool open(const std::string& path, const Features::Pyramid& spec);
+
+        bool isOpen() const {return file.is_open();}
+
+        void close() {file.close();}
+
+        // Add a record. features has to have spec.cells() entries.
+        void append(const std::uint32_t board, const int move, const std::span<const std::uint8_t> features);
+
+        void flush() {file.flush();}
+
+        // Bytes in every record for a pyramid
+        static size_t recordBytes(const Features::Pyramid& spec);
+
+    private:
+        std::ofstream file;
+        Features::Pyramid pyramid;
+        std::string record;
+};
+
+#endif
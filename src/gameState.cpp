@@ -0,0 +1,248 @@
+#include <iostream>
+#include <string>
+
+#include "gameState.h"
+
+namespace {
+    struct Line {
+        std::uint64_t mask;
+        GameTypes::WinLine ends;
+    };
+
+    // How many runs of K cells fit on an M x N board: along rows, columns, then both diagonals
+    template <int M, int N, int K>
+    constexpr int countLines() {
+        const int alongRows = K <= N ? M * (N - K + 1) : 0;
+        const int alongCols = K <= M ? (M - K + 1) * N : 0;
+        const int diagonals = K <= M && K <= N ? 2 * (M - K + 1) * (N - K + 1) : 0;
+        return alongRows + alongCols + diagonals;
+    }
+
+    // Every way to win, in the order we check them: rows, columns, top left to bottom right
+    // diagonals, then top right to bottom left diagonals. On a 3x3 board that's the 8 lines.
+    template <int M, int N, int K>
+    constexpr std::array<Line, countLines<M, N, K>()> buildLines() {
+        std::array<Line, countLines<M, N, K>()> lines = {};
+        int count = 0;
+        constexpr std::array<std::array<int, 2>, 4> directions = {{{0, 1}, {1, 0}, {1, 1}, {1, -1}}}; // {row, col} steps
+        for (const auto& [rowStep, colStep] : directions) {
+            for (int row = 0; row < M; row++) {
+                for (int col = 0; col < N; col++) {
+                    // Only runs that start here and stay on the board
+                    const int lastRow = row + rowStep * (K - 1);
+                    const int lastCol = col + colStep * (K - 1);
+                    if (lastRow >= M || lastCol < 0 || lastCol >= N) {
+                        continue;
+                    }
+                    Line line = {0, {row * N + col, lastRow * N + lastCol}};
+                    for (int i = 0; i < K; i++) {
+                        line.mask |= std::uint64_t(1) << ((row + rowStep * i) * N + col + colStep * i);
+                    }
+                    lines[count++] = line;
+                }
+            }
+        }
+        return lines;
+    }
+
+    template <int M, int N, int K>
+    constexpr auto winLines = buildLines<M, N, K>();
+
+    template <int M, int N, int K>
+    constexpr auto buildMasks() {
+        std::array<std::uint64_t, winLines<M, N, K>.size()> masks = {};
+        for (size_t line = 0; line < masks.size(); line++) {
+            masks[line] = winLines<M, N, K>[line].mask;
+        }
+        return masks;
+    }
+
+    template <int M, int N, int K>
+    constexpr auto winMasks = buildMasks<M, N, K>();
+
+    // The lines through each cell, in the same order as winLines. At most K in each of the 4 directions.
+    template <int M, int N, int K>
+    struct CellLines {
+        std::array<std::array<std::uint16_t, 4 * K>, M * N> lines = {};
+        std::array<int, M * N> counts = {};
+    };
+
+    template <int M, int N, int K>
+    constexpr CellLines<M, N, K> buildCellLines() {
+        CellLines<M, N, K> result;
+        for (size_t line = 0; line < winLines<M, N, K>.size(); line++) {
+            for (int cell = 0; cell < M * N; cell++) {
+                if (winLines<M, N, K>[line].mask & (std::uint64_t(1) << cell)) {
+                    result.lines[cell][result.counts[cell]++] = static_cast<std::uint16_t>(line);
+                }
+            }
+        }
+        return result;
+    }
+
+    template <int M, int N, int K>
+    constexpr auto cellLines = buildCellLines<M, N, K>();
+}
+
+template <int M, int N, int K>
+bool BasicGameState<M, N, K>::playMove(const int cellIndex) {
+    if (isOver() || !canPlace(cellIndex)) {
+        return false;
+    }
+
+    // Place a shape depending on the current turn
+    const CellState shape = turn ? CIRCLE : X;
+    if (shape == X) {
+        xBits |= bit(cellIndex);
+    } else {
+        circleBits |= bit(cellIndex);
+    }
+    moveCount++;
+    status = PLAYING;
+
+    // Switch to the next player
+    turn = (turn + 1) % 2;
+    if (observer.target) {
+        observer.target->onPlace(cellIndex, shape);
+    }
+
+    // Check if that move won or filled the board
+    const auto winData = checkMove(cellIndex, shape);
+    if (winData.first != CLEAR) {
+        switch (winData.first) {
+            case CIRCLE:
+                status = C_WIN;
+                break;
+            case X:
+                status = X_WIN;
+                break;
+            default:
+                status = DRAW;
+                break;
+        }
+        if (observer.target) {
+            observer.target->onGameEnd(winData);
+        }
+    }
+    return true;
+}
+
+template <int M, int N, int K>
+GameTypes::CellState BasicGameState<M, N, K>::getCell(const int cellIndex) const {
+    if (xBits & bit(cellIndex)) return X;
+    if (circleBits & bit(cellIndex)) return CIRCLE;
+    return CLEAR;
+}
+
+template <int M, int N, int K>
+typename BasicGameState<M, N, K>::Grid BasicGameState<M, N, K>::getGrid() const {
+    Grid grid;
+    for (int cell = 0; cell < cells; cell++) {
+        grid[cell / N][cell % N] = getCell(cell);
+    }
+    return grid;
+}
+
+template <int M, int N, int K>
+std::pair<int, GameTypes::WinLine> BasicGameState<M, N, K>::checkWin() const {
+    // A win occurs if there are K in a row of either shape.
+    // A draw occurs if there is no win and every cell is full.
+    for (const Line& line : winLines<M, N, K>) {
+        if ((xBits & line.mask) == line.mask) {
+            return std::pair{X, line.ends};
+        }
+        if ((circleBits & line.mask) == line.mask) {
+            return std::pair{CIRCLE, line.ends};
+        }
+    }
+
+    // If we reach this point, there is no win.
+    // Check if every cell is full (i.e. not CLEAR)
+    if ((xBits | circleBits) != fullBoard) {
+        return std::pair{CLEAR, WinLine()};
+    }
+
+    // If we reach this state, neither side has won and every cell is full.
+    return std::pair{-1, WinLine()};
+}
+
+template <int M, int N, int K>
+std::pair<int, GameTypes::WinLine> BasicGameState<M, N, K>::checkMove(const int cellIndex, const CellState shape) const {
+    // Nobody had won before this move, so the only lines that can be complete now are
+    // the mover's lines through this cell. Checked in the same order as checkWin, so a move
+    // that completes two lines at once reports the same one.
+    const Bitboard bits = shape == X ? xBits : circleBits;
+    const auto& through = cellLines<M, N, K>;
+    for (int i = 0; i < through.counts[cellIndex]; i++) {
+        const Line& line = winLines<M, N, K>[through.lines[cellIndex][i]];
+        if ((bits & line.mask) == line.mask) {
+            return std::pair{shape, line.ends};
+        }
+    }
+
+    // No win, so it's a draw if that was the last empty cell
+    if (moveCount < cells) {
+        return std::pair{CLEAR, WinLine()};
+    }
+    return std::pair{-1, WinLine()};
+}
+
+template <int M, int N, int K>
+bool BasicGameState<M, N, K>::winsAt(const int cellIndex, const CellState shape) const {
+    const Bitboard bits = (shape == X ? xBits : circleBits) | bit(cellIndex);
+    const auto& through = cellLines<M, N, K>;
+    for (int i = 0; i < through.counts[cellIndex]; i++) {
+        const Line& line = winLines<M, N, K>[through.lines[cellIndex][i]];
+        if ((bits & line.mask) == line.mask) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <int M, int N, int K>
+std::span<const std::uint64_t> BasicGameState<M, N, K>::lineMasks() {
+    return winMasks<M, N, K>;
+}
+
+template <int M, int N, int K>
+void BasicGameState<M, N, K>::reset() {
+    xBits = 0;
+    circleBits = 0;
+    moveCount = 0;
+    turn = 0;
+    status = STARTING;
+    if (observer.target) {
+        observer.target->onReset();
+    }
+}
+
+template <int M, int N, int K>
+void BasicGameState<M, N, K>::printGrid() const {
+    for (int row = 0; row < M; row++) {
+        std::string out = "[";
+        for (int col = 0; col < N; col++) {
+            std::string name;
+            switch (getCell(row * N + col)) {
+                case CIRCLE:
+                    name = "C";
+                    break;
+                case X:
+                    name = "X";
+                    break;
+                case CLEAR:
+                default:
+                    name = "_";
+            }
+            out += name;
+        }
+        out += "]";
+        std::cout << out << std::endl;
+    }
+}
+
+// The sizes we build: Tic Tac Toe, 4 in a row on 4x4, and gomoku-style 4 in a row on 5x5.
+// Add a line here (and in geometry.cpp, boardFeatures.cpp, search.cpp and mcts.cpp) to play on another size.
+template class BasicGameState<3, 3, 3>;
+template class BasicGameState<4, 4, 4>;
+template class BasicGameState<5, 5, 4>;
@@ -0,0 +1,182 @@
+#ifndef GAME_STATE_H
+#define GAME_STATE_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+struct GameTypes {
+    // What's in a cell and how a game ends. The same for every size of board.
+    enum CellState {
+        CLEAR = 0,
+        CIRCLE = 1,
+        X = 2
+    };
+
+    enum Status {
+        STARTING = 0,
+        PLAYING = 1,
+        X_WIN = 2,
+        C_WIN = 3,
+        DRAW = 4
+    };
+
+    // The cells at either end of a winning line, in the order they're numbered. -1 if nobody won.
+    // For a diagonal from top right to bottom left, first is the top right cell.
+    struct WinLine {
+        int first = -1;
+        int last = -1;
+    };
+};
+
+// The state of every cell of an M x N board, indexed [row][col]
+template <int M, int N>
+using BasicGrid = std::array<std::array<GameTypes::CellState, N>, M>;
+
+class GameObserver {
+    // Receives updates from a game state as the game is played
+    public:
+        // A shape was placed in a cell
+        virtual void onPlace(const int cellIndex, const GameTypes::CellState shape) {}
+
+        // The game was won or drawn. winData is the result of checkWin.
+        virtual void onGameEnd(const std::pair<int, GameTypes::WinLine>& winData) {}
+
+        // The game was reset
+        virtual void onReset() {}
+
+        virtual ~GameObserver() = default;
+};
+
+template <int M, int N, int K>
+class BasicGameState : public GameTypes {
+    // The rules of the game and nothing else. No rendering, no OpenGL, so anything
+    // (the game, simulators, benchmarks, servers) can use it.
+    // The board has M rows and N columns, and the first player to get K of their shape
+    // in a row, column or diagonal wins. Tic Tac Toe is 3, 3, 3 (see GameState below).
+    // A sector can either have nothing, an X, or a circle
+    // The Tic Tac Toe board looks something like this:
+    /*
+        _|_|_
+        _|_|_
+         | |
+    */
+    // The cells are numbered row by row, so on a 3x3 board:
+    // 0, 1, 2
+    // 3, 4, 5
+    // 6, 7, 8
+    // Internally each player's cells are kept as a bitboard, with bit i set if they own cell i.
+    // Every size is compiled on its own, with its ways to win worked out at compile time.
+    // The members are defined in gameState.cpp, which instantiates the sizes we use.
+    static_assert(M > 0 && N > 0 && K > 0 && (K <= M || K <= N), "K in a row has to fit on the board");
+    static_assert(M * N <= 64, "Each player's cells have to fit in a 64 bit bitboard");
+
+    public:
+        static constexpr int rows = M;
+        static constexpr int cols = N;
+        static constexpr int inARow = K;
+        static constexpr int cells = M * N;
+
+        // The state of every cell, indexed [row][col]
+        using Grid = BasicGrid<M, N>;
+
+        // Bit i is set if cell i is occupied. The smallest integer that fits every cell.
+        using Bitboard = std::conditional_t<cells <= 16, std::uint16_t, std::conditional_t<cells <= 32, std::uint32_t, std::uint64_t>>;
+        static constexpr Bitboard fullBoard = cells == 64 ? ~Bitboard(0) : Bitboard((std::uint64_t(1) << (cells % 64)) - 1);
+
+        BasicGameState() = default;
+
+        // Returns true if a cell exists and is not occupied
+        bool canPlace(const int cellIndex) const {
+            return cellIndex >= 0 && cellIndex < cells && !((xBits | circleBits) & bit(cellIndex));
+        }
+
+        // Place the current player's shape in a cell, switch turns and check for the end
+        // of the game. Returns false (and changes nothing) if the move isn't legal.
+        bool playMove(const int cellIndex);
+
+        // Get what's in a cell
+        CellState getCell(const int cellIndex) const;
+
+        // Get the whole board as a grid
+        Grid getGrid() const;
+
+        // Get the cells owned by either player
+        Bitboard getBits(const CellState shape) const {return shape == X ? xBits : circleBits;}
+
+        // Get who's turn it is
+        // 0 = X, 1 = Circle
+        int getTurn() const {return turn;}
+
+        // Get how many moves have been played
+        int getMoveCount() const {return moveCount;}
+
+        // Check if the game has been won or has ended in a draw
+        // Returns the integer corresponding to CellState for a win,
+        // returns the integer value of CellState.CLEAR for no win,
+        // returns -1 on draw.
+        // The WinLine says which cells the winning line runs between.
+        // This checks every line. playMove only checks the lines through the move it played.
+        std::pair<int, WinLine> checkWin() const;
+
+        // Get the state of the game
+        Status getStatus() const {return status;}
+
+        // Check if the game is over
+        bool isOver() const {return status != PLAYING && status != STARTING;}
+
+        // Reset to the initial state
+        void reset();
+
+        // Check if placing a shape in an empty cell would complete a line, without placing it.
+        // Only looks at the lines through that cell.
+        bool winsAt(const int cellIndex, const CellState shape) const;
+
+        // Every way to win, as a mask of its cells: rows, columns, then both diagonals
+        static std::span<const std::uint64_t> lineMasks();
+
+        // Attach something (e.g. a renderer) to be told about moves. Pass nullptr to detach.
+        // Copies of a game start without an observer, so policies can try out moves on a copy
+        // of the game on screen without drawing them.
+        void setObserver(GameObserver* gameObserver) {observer.target = gameObserver;}
+
+        // Debug print the grid to output
+        void printGrid() const;
+
+    private:
+        static constexpr Bitboard bit(const int cellIndex) {return static_cast<Bitboard>(Bitboard(1) << cellIndex);}
+
+        // checkWin for a shape that was just placed in a cell: only the lines through that cell
+        // can have been completed, and the board is full once every cell has had a move
+        std::pair<int, WinLine> checkMove(const int cellIndex, const CellState shape) const;
+
+        Bitboard xBits = 0;
+        Bitboard circleBits = 0;
+
+        // Moves played so far, so a full board doesn't need the bitboards
+        int moveCount = 0;
+
+        // Will either be 1 or 0
+        unsigned int turn = 0;
+
+        // store the current Status
+        Status status = STARTING;
+
+        // Not copied along with the rest of the game
+        struct ObserverLink {
+            GameObserver* target = nullptr;
+            ObserverLink() = default;
+            ObserverLink(const ObserverLink&) {}
+            ObserverLink& operator=(const ObserverLink&) {return *this;}
+        };
+
+        // Optional, may be nullptr
+        ObserverLink observer;
+};
+
+// The game we play. The renderer, the features, symmetries, perfect play, search and the model are built for it.
+using GameState = BasicGameState<3, 3, 3>;
+
+#endif
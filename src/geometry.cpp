@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numbers>
+
+#include "geometry.h"
+#include "constants.h"
+
+namespace {
+    // Where the boundary between cells i - 1 and i is, along an axis split into count cells.
+    // Rounded to hundredths, as the 3x3 board always was (its inner lines are at -0.33 and 0.33),
+    // so the 3x3 board and its features are exactly as before.
+    float boundary(const int i, const int count) {
+        return std::round((-1.0f + 2.0f * static_cast<float>(i) / static_cast<float>(count)) * 100.0f) / 100.0f;
+    }
+
+    template <int M, int N>
+    Geometry::Mesh generateBoardVertices() {
+        std::vector<float> verts;
+        std::vector<int> indices;
+        // When drawing the board, we need a line (across the entire height or width
+        // of the screen) between every two columns and every two rows. On a 3x3 board that's
+        // 4 lines (2 vertical, 2 horizontal). Each of these lines will contain 4 points.
+        // None of these vertices will be shared. Each line will be TTT::lineWidth wide
+        float offset = TTT::lineWidth;
+
+        // Vertical lines between the columns, split into triangles bl, tr, tl and bl, br, tr
+        for (int col = 1; col < N; col++) {
+            const int first = static_cast<int>(verts.size()) / 3;
+            const float x = boundary(col, N);
+            verts.insert(verts.end(), {
+                x - offset, -0.9f, 0.0f,
+                x + offset, -0.9f, 0.0f,
+                x - offset, 0.9f, 0.0f,
+                x + offset, 0.9f, 0.0f
+            });
+            indices.insert(indices.end(), {first, first + 2, first + 3, first, first + 1, first + 3});
+        }
+
+        // Horizontal lines between the rows, top one first
+        for (int row = M - 1; row > 0; row--) {
+            const int first = static_cast<int>(verts.size()) / 3;
+            const float y = boundary(row, M);
+            verts.insert(verts.end(), {
+                -0.9f, y - offset, 0.0f,
+                -0.9f, y + offset, 0.0f,
+                0.9f, y - offset, 0.0f,
+                0.9f, y + offset, 0.0f
+            });
+            indices.insert(indices.end(), {first, first + 1, first + 2, first + 1, first + 2, first + 3});
+        }
+
+        return std::pair{verts, indices};
+    }
+
+    Geometry::Mesh generateXVertices() {
+        // The X is built for a cell of Geometry::cellSize centered on the origin.
+        // The below array lists the central points for each X that
+        // will be connected. They sit a quarter of the way in from each edge of the cell.
+        const float quarter = Geometry::cellSize / 4.0f;
+        std::array<std::array<float, 2>, 4> xPoints = {
+            {
+                {-quarter, quarter},
+                {-quarter, -quarter},
+                {quarter, -quarter},
+                {quarter, quarter}
+            }
+        };
+
+        // Finally, we construct the resulting array of points and triangles
+        // by determining the corner points of each line from the central points
+        // using the TTT::lineWidth offset.
+        // We could do some fancy trig to make it look better, but for now we'll just
+        // add / subtract half the lineWidth to each dimension from the point
+        float halfOffset = TTT::lineWidth;
+        // We have 4 points for each line, each with 3 dimensions, so we need a flat array
+        // of length 12 for each line. Since we have two lines (0,2 and 1,3), we need an array
+        // of length 24.
+        std::vector<float> rawXPoints = {
+            xPoints[0][0] + halfOffset, xPoints[0][1] + halfOffset, 0.0f, // xyz for point 0 (top left)
+            xPoints[0][0] - halfOffset, xPoints[0][1] - halfOffset, 0.0f,
+            xPoints[2][0] + halfOffset, xPoints[2][1] + halfOffset, 0.0f, // xyz for point 2 (bottom right)
+            xPoints[2][0] - halfOffset, xPoints[2][1] - halfOffset, 0.0f,
+            xPoints[1][0] + halfOffset, xPoints[1][1] - halfOffset, 0.0f, // xyz for point 1 (bottom left)
+            xPoints[1][0] - halfOffset, xPoints[1][1] + halfOffset, 0.0f,
+            xPoints[3][0] + halfOffset, xPoints[3][1] - halfOffset, 0.0f, // xyz for point 3 (top right)
+            xPoints[3][0] - halfOffset, xPoints[3][1] + halfOffset, 0.0f,
+        };
+        // Since we have 4 triangles, each consisting of 3 points, we will need an array of length 12.
+        std::vector<int> indices = {
+            0, 1, 2,
+            1, 2, 3,
+            4, 5, 7,
+            4, 6, 7
+        };
+
+        return std::pair{rawXPoints, indices};
+    }
+
+    Geometry::Mesh generateCircleVertices(const int segments) {
+        // A ring centered on the origin. Its middle runs through the same quarter points
+        // as the X and it is as thick as the board lines.
+        // Every segment has an outer and an inner point, and each pair of neighbouring
+        // segments is joined by 2 triangles.
+        const float radius = Geometry::cellSize / 4.0f;
+        const float outer = radius + TTT::lineWidth;
+        const float inner = radius - TTT::lineWidth;
+
+        std::vector<float> vertices;
+        std::vector<int> indices;
+        vertices.reserve(segments * 2 * 3);
+        indices.reserve(segments * 6);
+        for (int i = 0; i < segments; i++) {
+            const float angle = 2.0f * std::numbers::pi_v<float> * static_cast<float>(i) / static_cast<float>(segments);
+            const float c = std::cos(angle);
+            const float s = std::sin(angle);
+            vertices.insert(vertices.end(), {outer * c, outer * s, 0.0f, inner * c, inner * s, 0.0f});
+
+            // Outer and inner points of this segment are 2i and 2i + 1, wrapping around at the end
+            const int next = (i + 1) % segments;
+            indices.insert(indices.end(), {2 * i, 2 * i + 1, 2 * next, 2 * i + 1, 2 * next + 1, 2 * next});
+        }
+
+        return std::pair{vertices, indices};
+    }
+
+    Geometry::Mesh generateRowVertices() {
+        // A horizontal bar across the whole board through y = 0.
+        // It is moved to the winning row's height when placed.
+        float offset = TTT::lineWidth * 2.0f;
+        std::vector<float> vertices = {
+            -0.9f, offset, 0.0f,
+            -0.9f, -offset, 0.0f,
+            0.9f, offset, 0.0f,
+            0.9f, -offset, 0.0f,
+        };
+
+        std::vector<int> indices = {
+            0, 1, 2,
+            3, 1, 2
+        };
+
+        return std::pair{vertices, indices};
+    }
+
+    Geometry::Mesh generateColVertices() {
+        // A vertical bar across the whole board through x = 0.
+        // It is moved to the winning column when placed.
+        float offset = TTT::lineWidth * 2.0f;
+        std::vector<float> vertices = {
+            offset, -0.9f, 0.0f,
+            -offset, -0.9f, 0.0f,
+            offset, 0.9f, 0.0f,
+            -offset, 0.9f, 0.0f,
+        };
+
+        std::vector<int> indices = {
+            0, 1, 2,
+            3, 1, 2
+        };
+
+        return std::pair{vertices, indices};
+    }
+
+    Geometry::Mesh generateDiagonalVertices() {
+        // The top left to bottom right diagonal (cell 0 to cell 8).
+        // The other diagonal (cell 2 to cell 6) is this one mirrored in x.
+        float offset = TTT::lineWidth * 1.5f;
+
+        std::vector<float> vertices = {
+            -0.9f + offset, 0.9f + offset, 0.0f,
+            -0.9f - offset, 0.9f - offset, 0.0f,
+            0.9f + offset, -0.9f + offset, 0.0f,
+            0.9f - offset, -0.9f - offset, 0.0f,
+        };
+
+        std::vector<int> indices = {
+            0, 1, 2,
+            3, 1, 2
+        };
+
+        return std::pair{vertices, indices};
+    }
+}
+
+template <int M, int N>
+std::array<Geometry::Mesh, Geometry::GLYPH_COUNT> Geometry::buildGlyphs(const int circleSegments) {
+    std::array<Mesh, GLYPH_COUNT> glyphs;
+    glyphs[BOARD] = generateBoardVertices<M, N>();
+    glyphs[X_SHAPE] = generateXVertices();
+    glyphs[CIRCLE] = generateCircleVertices(circleSegments);
+    glyphs[ROW_BAR] = generateRowVertices();
+    glyphs[COL_BAR] = generateColVertices();
+    glyphs[DIAGONAL] = generateDiagonalVertices();
+    return glyphs;
+}
+
+template <int M, int N>
+std::array<std::array<float, 2>, 2> Geometry::getCoordinateRange(const int cellIndex) {
+    // Next, we translate these local points to global points depending
+    // which cell we're in. On a 3x3 board there are 3 possible ranges to which we
+    // need to translate:
+    //  - 0: [-1.0f, -0.33f]
+    //  - 1: [-0.33f, 0.33f]
+    //  - 2: [0.33f, 1.0f]
+    // The cell grid is outlined as follows:
+    // 0, 1, 2
+    // 3, 4, 5
+    // 6, 7, 8
+    // So, 0, 3, 6 belong to 0 in x, and 0, 1, 2 belong to 2 in y since y points up.
+    // Other sizes are split the same way, into N columns and M rows.
+    const int row = cellIndex / N;
+    const int col = cellIndex % N;
+    return {{
+        {boundary(col, N), boundary(col + 1, N)},
+        {boundary(M - 1 - row, M), boundary(M - row, M)}
+    }};
+}
+
+template <int M, int N>
+int Geometry::cellAt(const float x, const float y) {
+    // Move the point to normalized device coordinates (y up) and find the cell whose range it's in,
+    // so clicks land in the cells exactly as they're drawn
+    const float deviceX = x * 2.0f - 1.0f;
+    const float deviceY = 1.0f - y * 2.0f;
+    int col = -1;
+    for (int i = 0; i < N; i++) {
+        if (deviceX >= boundary(i, N) && deviceX <= boundary(i + 1, N)) {
+            col = i;
+            break;
+        }
+    }
+    int row = -1;
+    for (int i = 0; i < M; i++) {
+        if (deviceY <= boundary(M - i, M) && deviceY >= boundary(M - 1 - i, M)) {
+            row = i;
+            break;
+        }
+    }
+    return row < 0 || col < 0 ? -1 : row * N + col;
+}
+
+template <int M, int N>
+Geometry::Instance Geometry::cellInstance(const Glyph glyph, const int cellIndex) {
+    // Move the glyph to the middle of the cell and stretch it to the cell's size.
+    // The cells aren't all exactly cellSize wide, so on a 3x3 board the scale is very nearly 1.
+    const auto localRange = getCoordinateRange<M, N>(cellIndex);
+    const float centerX = (localRange[0][0] + localRange[0][1]) / 2.0f;
+    const float centerY = (localRange[1][0] + localRange[1][1]) / 2.0f;
+    const float scaleX = (localRange[0][1] - localRange[0][0]) / cellSize;
+    const float scaleY = (localRange[1][1] - localRange[1][0]) / cellSize;
+    return Instance{glyph, {centerX, centerY, scaleX, scaleY}};
+}
+
+template <int M, int N>
+std::pmr::vector<Geometry::Instance> Geometry::gridInstances(const std::type_identity_t<BasicGrid<M, N>>& grid, std::pmr::memory_resource* memory) {
+    std::pmr::vector<Instance> result(memory);
+    result.reserve(1 + M * N);
+    result.push_back(Instance{BOARD, {0.0f, 0.0f, 1.0f, 1.0f}});
+
+    for (int cellIndex = 0; cellIndex < M * N; cellIndex++) {
+        const GameTypes::CellState state = grid[cellIndex / N][cellIndex % N];
+        if (state == GameTypes::CLEAR) {
+            continue;
+        }
+        result.push_back(cellInstance<M, N>(state == GameTypes::X ? X_SHAPE : CIRCLE, cellIndex));
+    }
+
+    return result;
+}
+
+template <int M, int N>
+bool Geometry::winInstance(const GameTypes::WinLine winLine, Instance& instance) {
+    if (winLine.first < 0 || winLine.last < 0 || winLine.first >= M * N || winLine.last >= M * N) {
+        std::cout << "ERROR::WIN::INVALID_VERTICES" << std::endl;
+        return false;
+    }
+
+    // The bar covers both end cells, less a margin of 15% of a cell at each end
+    // (about 0.1 on a 3x3 board, where a full length bar runs from -0.9 to 0.9)
+    const auto first = getCoordinateRange<M, N>(winLine.first);
+    const auto last = getCoordinateRange<M, N>(winLine.last);
+    const float marginX = 0.15f * (first[0][1] - first[0][0]);
+    const float marginY = 0.15f * (first[1][1] - first[1][0]);
+    const float left = std::min(first[0][0], last[0][0]) + marginX;
+    const float right = std::max(first[0][1], last[0][1]) - marginX;
+    const float bottom = std::min(first[1][0], last[1][0]) + marginY;
+    const float top = std::max(first[1][1], last[1][1]) - marginY;
+    const float centerX = (left + right) / 2.0f;
+    const float centerY = (bottom + top) / 2.0f;
+
+    // Every bar is built 1.8 long, so stretch it to the line's length.
+    // We have 3 cases: row, column, and diagonal
+    const int firstRow = winLine.first / N;
+    const int lastRow = winLine.last / N;
+    const int firstCol = winLine.first % N;
+    const int lastCol = winLine.last % N;
+    if (firstRow == lastRow) {
+        instance = Instance{ROW_BAR, {centerX, centerY, (right - left) / 1.8f, 1.0f}};
+    } else if (firstCol == lastCol) {
+        instance = Instance{COL_BAR, {centerX, centerY, 1.0f, (top - bottom) / 1.8f}};
+    } else {
+        // Top left to bottom right is as built, top right to bottom left is mirrored
+        const float mirror = firstCol < lastCol ? 1.0f : -1.0f;
+        instance = Instance{DIAGONAL, {centerX, centerY, mirror * (right - left) / 1.8f, (top - bottom) / 1.8f}};
+    }
+    return true;
+}
+
+// The board sizes we build (see the bottom of gameState.cpp)
+template std::array<Geometry::Mesh, Geometry::GLYPH_COUNT> Geometry::buildGlyphs<3, 3>(const int);
+template std::array<Geometry::Mesh, Geometry::GLYPH_COUNT> Geometry::buildGlyphs<4, 4>(const int);
+template std::array<Geometry::Mesh, Geometry::GLYPH_COUNT> Geometry::buildGlyphs<5, 5>(const int);
+template std::array<std::array<float, 2>, 2> Geometry::getCoordinateRange<3, 3>(const int);
+template std::array<std::array<float, 2>, 2> Geometry::getCoordinateRange<4, 4>(const int);
+template std::array<std::array<float, 2>, 2> Geometry::getCoordinateRange<5, 5>(const int);
+template int Geometry::cellAt<3, 3>(const float, const float);
+template int Geometry::cellAt<4, 4>(const float, const float);
+template int Geometry::cellAt<5, 5>(const float, const float);
+template Geometry::Instance Geometry::cellInstance<3, 3>(const Glyph, const int);
+template Geometry::Instance Geometry::cellInstance<4, 4>(const Glyph, const int);
+template Geometry::Instance Geometry::cellInstance<5, 5>(const Glyph, const int);
+template std::pmr::vector<Geometry::Instance> Geometry::gridInstances<3, 3>(const BasicGrid<3, 3>&, std::pmr::memory_resource*);
+template std::pmr::vector<Geometry::Instance> Geometry::gridInstances<4, 4>(const BasicGrid<4, 4>&, std::pmr::memory_resource*);
+template std::pmr::vector<Geometry::Instance> Geometry::gridInstances<5, 5>(const BasicGrid<5, 5>&, std::pmr::memory_resource*);
+template bool Geometry::winInstance<3, 3>(const GameTypes::WinLine, Instance&);
+template bool Geometry::winInstance<4, 4>(const GameTypes::WinLine, Instance&);
+template bool Geometry::winInstance<5, 5>(const GameTypes::WinLine, Instance&);
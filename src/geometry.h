@@ -0,0 +1,68 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <array>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "gameState.h"
+
+namespace Geometry {
+    // Everything that depends on the board's layout is templated on its rows (M) and columns (N)
+    // and defaults to the game we play. The sizes we use are instantiated in geometry.cpp.
+    // A grid can't tell a template its size (std::array sizes aren't ints), so other sizes are
+    // always named, e.g. gridInstances<4, 4>(grid).
+
+    // Vertices (x, y, z) and the indices of the triangles drawn from them
+    using Mesh = std::pair<std::vector<float>, std::vector<int>>;
+
+    // Every shape we ever draw. Each is built once and then placed with a transform.
+    enum Glyph {
+        BOARD = 0,      // The lines between the cells of the board, already in place
+        X_SHAPE = 1,    // An X centered on the origin, sized for a cell
+        CIRCLE = 2,     // A ring centered on the origin, sized for a cell
+        ROW_BAR = 3,    // A horizontal win bar through the origin
+        COL_BAR = 4,    // A vertical win bar through the origin
+        DIAGONAL = 5,   // A win bar from top left to bottom right. Mirror it for the other diagonal.
+        GLYPH_COUNT = 6
+    };
+
+    // A glyph and where to put it. The transform is (offset x, offset y, scale x, scale y)
+    // and is applied as position * scale + offset by the vertex shader.
+    struct Instance {
+        Glyph glyph;
+        std::array<float, 4> transform;
+    };
+
+    // The size of a cell's glyphs before placement, in normalized device coordinates
+    constexpr float cellSize = 2.0f / 3.0f;
+
+    // Build every glyph. The circle is made of circleSegments segments.
+    template <int M = GameState::rows, int N = GameState::cols>
+    std::array<Mesh, GLYPH_COUNT> buildGlyphs(const int circleSegments);
+
+    // Get the proper coordinate range for each cell as {x range, y range}
+    template <int M = GameState::rows, int N = GameState::cols>
+    std::array<std::array<float, 2>, 2> getCoordinateRange(const int cellIndex);
+
+    // The cell under a point given as a fraction of the window's width and height from its top left,
+    // or -1 if the point isn't on the board
+    template <int M = GameState::rows, int N = GameState::cols>
+    int cellAt(const float x, const float y);
+
+    // Place an X or circle in a cell
+    template <int M = GameState::rows, int N = GameState::cols>
+    Instance cellInstance(const Glyph glyph, const int cellIndex);
+
+    // Place the board outline and every shape on a grid, allocated from memory
+    template <int M = GameState::rows, int N = GameState::cols>
+    std::pmr::vector<Instance> gridInstances(const std::type_identity_t<BasicGrid<M, N>>& grid, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+    // Place the bar across a winning row, column or diagonal.
+    // See GameState::checkWin for winLine. Returns false if winLine is invalid.
+    template <int M = GameState::rows, int N = GameState::cols>
+    bool winInstance(const GameTypes::WinLine winLine, Instance& instance);
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include <SFML/Window/Context.hpp>
+
+#ifdef TTT_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <iostream>
+
+#include "headlessContext.h"
+
+#ifdef TTT_HAS_EGL
+namespace {
+    // Try to find a display that doesn't need a windowing system. We prefer
+    // an EGL device (GPU or llvmpipe), then Mesa's surfaceless platform, and
+    // finally whatever the default display happens to be.
+    EGLDisplay findHeadlessDisplay() {
+        auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+        if (queryDevices && getPlatformDisplay) {
+            EGLDeviceEXT devices[8];
+            EGLint deviceCount = 0;
+            if (queryDevices(8, devices, &deviceCount)) {
+                for (int i = 0; i < deviceCount; i++) {
+                    EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[i], NULL);
+                    if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+                        return display;
+                    }
+                }
+            }
+        }
+
+        if (getPlatformDisplay) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+            if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+                return display;
+            }
+        }
+
+        EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+            return display;
+        }
+        return EGL_NO_DISPLAY;
+    }
+}
+#endif
+
+HeadlessContext::HeadlessContext(const int width, const int height) {
+#ifdef TTT_HAS_EGL
+    EGLDisplay display = findHeadlessDisplay();
+    if (display == EGL_NO_DISPLAY) {
+        std::cout << "ERROR::HEADLESS::NO_EGL_DISPLAY" << std::endl;
+        initFailure = true;
+        return;
+    }
+    eglDisplay = display;
+
+    // Match the window's context settings as closely as we can
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_STENCIL_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+        std::cout << "ERROR::HEADLESS::NO_EGL_CONFIG" << std::endl;
+        initFailure = true;
+        return;
+    }
+
+    // The pbuffer is only a fallback target, we render into the Renderer's
+    // framebuffer object. If the platform can't give us one (surfaceless), that's fine.
+    const EGLint pbufferAttribs[] = {
+        EGL_WIDTH, width,
+        EGL_HEIGHT, height,
+        EGL_NONE
+    };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    eglSurface = surface;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "ERROR::HEADLESS::NO_OPENGL_API" << std::endl;
+        initFailure = true;
+        return;
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        std::cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED " << eglGetError() << std::endl;
+        initFailure = true;
+        return;
+    }
+    eglContext = context;
+
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        std::cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED " << eglGetError() << std::endl;
+        initFailure = true;
+        return;
+    }
+#else
+    sf::ContextSettings contextSettings;
+    contextSettings.depthBits = 24;
+    contextSettings.stencilBits = 8;
+    contextSettings.majorVersion = 4;
+    contextSettings.minorVersion = 3;
+    sfmlContext = std::make_unique<sf::Context>(contextSettings, sf::Vector2u(width, height));
+    if (!sfmlContext->setActive(true)) {
+        std::cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED" << std::endl;
+        initFailure = true;
+    }
+#endif
+}
+
+void* HeadlessContext::getProcAddress(const char* name) {
+#ifdef TTT_HAS_EGL
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+#else
+    return reinterpret_cast<void*>(sf::Context::getFunction(name));
+#endif
+}
+
+HeadlessContext::~HeadlessContext() {
+#ifdef TTT_HAS_EGL
+    if (eglDisplay) {
+        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (eglContext) eglDestroyContext(eglDisplay, eglContext);
+        if (eglSurface) eglDestroySurface(eglDisplay, eglSurface);
+        eglTerminate(eglDisplay);
+    }
+#endif
+}
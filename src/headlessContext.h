@@ -0,0 +1,42 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <memory>
+
+namespace sf {
+    class Context;
+}
+
+class HeadlessContext {
+    // Create an OpenGL context that isn't attached to any window so that we
+    // can render and capture screen data on machines without a display.
+    // On Linux this uses an EGL pbuffer (or surfaceless) context, which works
+    // with the Mesa software rasterizer. Everywhere else we fall back to
+    // SFML's windowless sf::Context.
+    public:
+        HeadlessContext(const int width, const int height);
+
+        // Returns true if we failed to create a context,
+        // otherwise returns false
+        bool initFailed() {return initFailure;}
+
+        // Look up an OpenGL function for GLAD
+        static void* getProcAddress(const char* name);
+
+        // Release the context and its surface
+        ~HeadlessContext();
+
+    private:
+        // If construction fails, will be set to true
+        bool initFailure = false;
+
+        // EGL handles. Stored as void* so we don't leak EGL headers to everyone.
+        void* eglDisplay = nullptr;
+        void* eglSurface = nullptr;
+        void* eglContext = nullptr;
+
+        // Used when EGL isn't available
+        std::unique_ptr<sf::Context> sfmlContext;
+};
+
+#endif
@@ -7,26 +7,35 @@
 #include <SFML/Window/Mouse.hpp>
 
 #include <SFML/Window/WindowEnums.hpp>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <future>
 #include <iostream>
-#include <queue>
-#include <mutex>
+#include <random>
 #include <stdio.h>
 #include <stdlib.h>
-#include <thread>
-#include <windows.h>
-#include <atomic>
 #include <string>
 
 #include "Game.h"
+#include "arena.h"
+#include "boardFeatures.h"
 #include "constants.h"
+#include "headlessContext.h"
+#include "modelPool.h"
+#include "policy.h"
+#include "profiler.h"
+#include "sessionLog.h"
+#include "symmetry.h"
 
 bool trainingMode = true; // If we're in training or testing mode
-std::atomic<bool> killThread = false;
-std::queue<std::string> msgQueue;
-std::mutex queueLock;
-int g_cellMove = -1;
-std::mutex moveLock;
+bool augmentRows = false; // If every exported row is also exported for each symmetry of the board
+ModelPool* modelPool = nullptr; // Set while the window is open. Exported rows are sent to it to learn from straight away.
+SessionLog* sessionLog = nullptr; // Set while the window is open. Every click, key and model move is recorded in it.
+bool quiet = false; // Replays skip the debug output of every move
+int validateFeatureCache = 0; // Check every n-th feature cache hit against the screen (0 never)
+Features::Pyramid featurePyramid; // Captured with every exported row when it has levels (see --pyramid)
 
 // Khronos debug function (see https://www.khronos.org/opengl/wiki/OpenGL_Error)
 void GLAPIENTRY MessageCallback( GLenum source,
@@ -40,71 +49,28 @@ void GLAPIENTRY MessageCallback( GLenum source,
     std::cerr << "GL CALLBACK: " << message << std::endl;
 }
 
-void playMove(GameBoard& board, const int cell) {
-    // Draw a shape depending on the current turn
-    if (board.getTurn()) {
-        board.placeCircle(cell);
-    } else {
-        board.placeX(cell);
-    }
+void playMove(GameState& game, const int cell) {
+    ScopeTimer timer("game");
+    // Place a shape depending on the current turn. The game checks for a win itself
+    // and the attached GameBoard draws the shape (and the win bar).
+    game.playMove(cell);
 
     // Output debug board
-    board.printGrid();
-
-    // Check if either side has won
-    const auto winData = board.checkWin();
-    if (winData.first != 0 && !board.isOver()) {
-        // If we detect a game ending condition but haven't yet updated the board, end the game
-        board.endGame(winData);
+    if (!quiet) {
+        game.printGrid();
     }
 }
 
-// Translate a mouse click into placing an element on the board
-int handleClick(const sf::Vector2f mousePosWindow, const sf::RenderWindow& window, GameBoard& board, CSVHandler& csvHandler) {
+// Play a move in a cell chosen by the player, exporting training data first.
+// Returns the cell played or -1 if the move wasn't valid.
+int applyCellMove(GameState& game, CSVHandler& csvHandler, const int cell) {
     // If the game is over, do nothing.
-    if (board.isOver()) {
+    if (game.isOver()) {
         return -1;
     }
 
-    // Determine the widths and heights of the colums and rows
-    sf::Vector2u windowSize = window.getSize();
-    float columnWidth = static_cast<float>(windowSize.x) / 3.0f;
-    float rowHeight = static_cast<float>(windowSize.y) / 3.0f; 
-
-    // We know that board is divided into three rows and three columns. Thus
-    // we have 3 possible ranges each for our point to be inside of
-    // Check if the position is invalid
-    if (mousePosWindow.x < 0 || mousePosWindow.x > windowSize.x || mousePosWindow.y < 0 || mousePosWindow.y > windowSize.y) {
-        std::cout << "ERROR::WINDOW::MOUSE_BEYOND_BOUNDS" << std::endl;
-        return  -1;
-    }
-
-    // TODO: There's likely a better algorithm to do this. Can I remove any of these if statements?
-    // Determine the column
-    int cell = 0;
-    if (mousePosWindow.x <= columnWidth) {
-        // first column - do nothing 
-    } else if (mousePosWindow.x <= columnWidth * 2.0f) {
-        // second column
-        cell = 1;
-    } else {
-        // third column
-        cell = 2;
-    }
-
-    // Determine the row
-    if (mousePosWindow.y <= rowHeight) {
-        // first row - do nothing
-    } else if (mousePosWindow.y <= rowHeight * 2.0f) {
-        // second column - move to the second row
-        cell += 3;
-    } else {
-        // third column - move to the third row
-        cell += 6;
-    }
-
     // Check to make sure we don't place a shape an an occupied cell 
-    if (!board.canPlace(cell)) {
+    if (!game.canPlace(cell)) {
         std::cout << "Cannot place on already placed cell." << std::endl;
         return  -1;
     }
@@ -115,178 +81,505 @@ int handleClick(const sf::Vector2f mousePosWindow, const sf::RenderWindow& windo
     // based o ncurrent screen data.
     // If we're in training mode, then we want to export our move data
     if (trainingMode && cell >= 0) {
-        csvHandler.exportMove(cell);
+        const auto rows = csvHandler.exportMove(cell, game);
+
+        // Let the model learn from them now rather than on its next launch
+        if (modelPool) {
+            for (const auto& row : rows) {
+                modelPool->broadcast("TRAIN[" + row + "]");
+            }
+        }
     }
 
     // Apply our move to the board
-    playMove(board, cell);
+    playMove(game, cell);
     
     // Some debug output
-    std::cout << "Clicked cell: " << cell << std::endl;
+    if (!quiet) {
+        std::cout << "Played cell: " << cell << std::endl;
+    }
     return cell;
 }
 
-void writeToPython(HANDLE pyStdInWr, std::string message) {
-    auto tid = std::this_thread::get_id();
-    // See https://learn.microsoft.com/en-us/windows/win32/procthread/creating-a-child-process-with-redirected-input-and-output
-
-    // Prepare message
-    std::string msg = message += "\n";
+// Translate a mouse click into placing an element on the board
+int handleClick(const sf::Vector2f mousePosWindow, const sf::Vector2u windowSize, GameState& game, CSVHandler& csvHandler) {
+    // If the game is over, do nothing.
+    if (game.isOver()) {
+        return -1;
+    }
 
-    // Write the message (Python must consume it to be non-blocking)
-    // See https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-writefile
-    DWORD bytesWritten = 0;
-    BOOL success = WriteFile(pyStdInWr, msg.c_str(),(DWORD)msg.size(), &bytesWritten, NULL);
-    
-    // Error checking
-    if (!success) {
-        std::cerr << "[" << tid << "] " << "Failed to write to Python: " << GetLastError() << std::endl;
-        return;
+    // Find the cell under the mouse, the same way the cells are laid out when they're drawn
+    const int cell = Geometry::cellAt(mousePosWindow.x / static_cast<float>(windowSize.x), mousePosWindow.y / static_cast<float>(windowSize.y));
+    if (sessionLog) {
+        sessionLog->click(mousePosWindow.x, mousePosWindow.y, windowSize.x, windowSize.y, cell);
+    }
+    if (cell < 0) {
+        std::cout << "ERROR::WINDOW::MOUSE_BEYOND_BOUNDS" << std::endl;
+        return  -1;
     }
 
-    // Otherwise
-    std::cout << std::flush << "[" << tid << "] " << "Wrote " << bytesWritten << " bytes to Python saying " << message << std::endl; 
+    return applyCellMove(game, csvHandler, cell);
 }
 
-void readFromPython(HANDLE pyStdOutRd) {
-    auto tid = std::this_thread::get_id();
-    // See https://learn.microsoft.com/en-us/windows/win32/procthread/creating-a-child-process-with-redirected-input-and-output    
+// Play a move the model didn't choose (the fallback policy's, or a random one), and record it
+void playFallbackMove(GameState& game, const int cell) {
+    if (sessionLog) {
+        sessionLog->fallbackMove(cell);
+    }
+    playMove(game, cell);
+}
 
-    // See https://learn.microsoft.com/en-us/windows/win32/api/namedpipeapi/nf-namedpipeapi-peeknamedpipe
-    DWORD bytesToRead = 0;
-    if (!PeekNamedPipe(pyStdOutRd, NULL, 0, NULL, &bytesToRead, NULL)) {
-        std::cerr << "[" << tid << "] " << "Failure to peek at pyStdOutRd" << std::endl;
+// A move we've asked the model for but haven't played yet. The game loop checks on it every
+// frame instead of waiting for it, so a slow or crashed model never stalls the window.
+struct ModelMove {
+    std::future<int> reply;
+    int attempts = 0;
+    std::chrono::steady_clock::time_point asked;
+    bool pending = false;
+};
+
+// Ask the model for a move. While the model is down the fallback policy plays instead, straight away.
+// When the opponent isn't the model at all (--opponent), the fallback is the opponent. It thinks on
+// its own thread and its move arrives the same way as the model's, so a slow one (e.g. search) doesn't
+// stall the window either.
+void requestModelMove(ModelMove& modelMove, GameState& game, CSVHandler& csvHandler, Policy& fallback, std::mt19937& rng) {
+    if (!modelPool) {
+        // Never let two searches share the opponent (e.g. after a restart mid-move)
+        if (modelMove.reply.valid()) {
+            modelMove.reply.wait();
+        }
+        modelMove.reply = std::async(std::launch::async, [&fallback, game, seed = rng()] {
+            std::mt19937 opponentRng(seed);
+            return fallback.chooseMove(game, opponentRng); // game is a copy, so its moves aren't drawn
+        });
+        modelMove.asked = std::chrono::steady_clock::now();
+        modelMove.pending = true;
+        if (sessionLog) {
+            sessionLog->modelRequest(modelMove.attempts);
+        }
         return;
     }
+    if (!modelPool->isReady()) {
+        std::cout << "Model isn't ready, using the fallback policy" << std::endl;
+        modelMove.pending = false;
+        playFallbackMove(game, fallback.chooseMove(game, rng));
+        return;
+    }
+    if (sessionLog) {
+        sessionLog->modelRequest(modelMove.attempts);
+    }
+    modelMove.reply = modelPool->requestMove(csvHandler.generateRowData(game, -1), modelMove.attempts);
+    modelMove.asked = std::chrono::steady_clock::now();
+    modelMove.pending = true;
+}
 
-    // If we have nothing available to read, then return
-    if (bytesToRead == 0) {
+// Play the model's move once it arrives. An illegal move is asked for again (up to
+// TTT::modelMaxAttempts times, then a random move is played, like the model does itself).
+// If the model fails or goes quiet, the fallback policy plays instead.
+void updateModelMove(ModelMove& modelMove, GameState& game, CSVHandler& csvHandler, Policy& fallback, std::mt19937& rng) {
+    if (!modelMove.pending) {
+        return;
+    }
+    if (game.isOver()) {
+        modelMove.pending = false;
         return;
     }
-    
-    // See also: https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-readfile
-    BOOL success = FALSE;
-    DWORD bytesRead = 0;
-    char buf[512];
-    success = ReadFile(pyStdOutRd, buf, sizeof(buf), &bytesRead, NULL);
-    if (success && bytesRead > 0) {
-        // Form a string with the result and output it
-        std::string result(buf, bytesRead);
-        std::cout << result << std::endl;
-
-        // Process data from Python
-        // std::string::find will search for a string and then return the index of the occurrence
-        size_t cmd = result.find("READY");
-        if (cmd != std::string::npos) {
-            std::cout << "[" << tid << "] " << "Python ready..." << std::endl;
-        }
 
-        size_t rspmv = result.find("RSPMV");
-        if (rspmv != std::string::npos) {
-            std::cout << "[" << tid << "] " << "RSPMV - Attempting to lock on move" << std::endl;
-            const std::lock_guard<std::mutex> lock(moveLock);
-            std::cout << "[" << tid << "] "<< "Received move: " << result[rspmv + 6] << std::endl;
-            const char* move = result.c_str() + rspmv + 6;
-            g_cellMove = atoi(move); // convert from ASCII character to integer value
+    if (modelMove.reply.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        // The pool times requests out itself, this is just in case. Other opponents always answer.
+        const auto waited = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - modelMove.asked).count();
+        if (modelPool && waited > TTT::modelReplyTimeoutMs + TTT::modelHeartbeatTimeoutMs) {
+            std::cerr << "ERROR::MODEL::MOVE_TIMED_OUT, using the fallback policy" << std::endl;
+            modelMove.pending = false;
+            playFallbackMove(game, fallback.chooseMove(game, rng));
         }
+        return;
+    }
+
+    const int move = modelMove.reply.get();
+    modelMove.pending = false;
+    if (sessionLog) {
+        sessionLog->modelReply(move, modelMove.attempts);
+    }
+    if (move < 0) {
+        std::cerr << "ERROR::MODEL::NO_MOVE, using the fallback policy" << std::endl;
+        playFallbackMove(game, fallback.chooseMove(game, rng));
+    } else if (game.canPlace(move)) {
+        std::cout << "Model played " << move << " on attempt " << modelMove.attempts << std::endl;
+        playMove(game, move);
+    } else if (modelMove.attempts >= TTT::modelMaxAttempts) {
+        std::cout << "Model ran out of attempts, playing a random move" << std::endl;
+        RandomPolicy random;
+        playFallbackMove(game, random.chooseMove(game, rng));
+    } else {
+        std::cout << "Model returned a bad value " << move << ". Trying again: Attempt: " << modelMove.attempts + 1 << std::endl;
+        modelMove.attempts++;
+        requestModelMove(modelMove, game, csvHandler, fallback, rng);
     }
-    std::cout << std::flush << "[" << tid << "] " << "Read " << bytesRead << " bytes from Python" << std::endl;
 }
 
-void runModel() {
-    auto tid = std::this_thread::get_id();
+// Setup OpenGL state shared by the windowed and headless modes
+void configureGL() {
+    // Enable debug output (see https://www.khronos.org/opengl/wiki/OpenGL_Error)
+    glEnable( GL_DEBUG_OUTPUT );
+    glDebugMessageCallback( MessageCallback, 0 );
+    glPixelStorei(GL_PACK_ROW_LENGTH, TTT::screenWidth); // Set to screenWidth number of pixels per row
+    glPixelStorei(GL_PACK_ALIGNMENT, 1); // Set to 1 byte pixel row alignment
+}
 
-    // Run our python model as a subprocess, we'll exchange input and output in the main update loop
-    std::string cmd = "python " + std::string(MODEL_PATH) + " " + std::string(CSV_PATH) + "/out_log.csv";
+// Run without a window. Commands are read one per line from stdin and mirror the keyboard controls:
+//  - "0" to "8" - Play a move in that cell (exporting training data in training mode)
+//  - "R" - Restart the game state
+//  - "T" - Toggle wireframe view
+//  - "M" - Switch between training and testing mode
+//  - "P" - Toggle profiling (reports are printed every Profiler::reportInterval commands)
+//  - "Q" - Quit (as does reaching the end of the input)
+int runHeadless() {
+    // Create an offscreen OpenGL context and setup GLAD
+    HeadlessContext context(TTT::screenWidth, TTT::screenHeight);
+    if (context.initFailed()) {
+        return -1;
+    }
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(HeadlessContext::getProcAddress))) {
+        return -1;
+    }
 
-    // see https://learn.microsoft.com/en-us/windows/win32/procthread/creating-a-child-process-with-redirected-input-and-output
-    HANDLE pyStd_IN_RD = NULL;
-    HANDLE pyStd_IN_WR = NULL;
-    HANDLE pyStd_OUT_RD = NULL;
-    HANDLE pyStd_OUT_WR = NULL;
-    SECURITY_ATTRIBUTES sas;
-    sas.nLength = sizeof(SECURITY_ATTRIBUTES);
-    sas.bInheritHandle = TRUE; // Allow inherited pipe handles
-    sas.lpSecurityDescriptor = NULL;
+    // Setup renderer, drawing into an offscreen framebuffer
+    Renderer glRenderer = Renderer();
+    if (glRenderer.initFailed() || !glRenderer.createOffscreenTarget(TTT::screenWidth, TTT::screenHeight)) {
+        return -1;
+    }
 
-    // Create pipes (see https://learn.microsoft.com/en-us/windows/win32/api/namedpipeapi/nf-namedpipeapi-createpipe)
-    if (!CreatePipe(&pyStd_OUT_RD, &pyStd_OUT_WR, &sas, 0)) {
-        std::cerr << "[" << tid << "] " << "Failed to create pipe: STDOUT" << std::endl;
-        return; // TODO: Beware these early returns
+    // Setup the game and draw it as it's played
+    GameState game;
+    GameBoard board = GameBoard(glRenderer);
+    game.setObserver(&board);
+    CSVHandler csvHandler;
+    csvHandler.setAugment(augmentRows);
+    csvHandler.setCacheValidation(validateFeatureCache);
+    if (!csvHandler.setPyramid(featurePyramid)) {
+        return -1;
     }
+    configureGL();
 
-    // Block read STDOUT inheritance (this avoids conflicts with the normal CreateProcess inheritance mechanism, I think)
-    SetHandleInformation(pyStd_OUT_RD, HANDLE_FLAG_INHERIT, 0);
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) {
+            continue;
+        }
 
-    // Handle STDIN pipe
-    if (!CreatePipe(&pyStd_IN_RD, &pyStd_IN_WR, &sas, 0)) {
-        std::cerr << "[" << tid << "] " << "Failed to create pipe: STDIN" << std::endl;
-        return;
+        // Make sure the framebuffer holds the current board before we capture it
+        board.drawBoard();
+
+        const char cmd = line[0];
+        if (cmd >= '0' && cmd <= '8') {
+            applyCellMove(game, csvHandler, cmd - '0');
+        } else if (cmd == 'R' || cmd == 'r') {
+            game.reset();
+        } else if (cmd == 'T' || cmd == 't') {
+            glRenderer.toggleWireframe();
+            csvHandler.setWireframe(glRenderer.isWireframe());
+        } else if (cmd == 'P' || cmd == 'p') {
+            Profiler::get().toggle();
+        } else if (cmd == 'M' || cmd == 'm') {
+            trainingMode = !trainingMode;
+            std::cout << "TRAINING MODE = " << trainingMode << std::endl;
+        } else if (cmd == 'Q' || cmd == 'q') {
+            break;
+        } else {
+            std::cout << "ERROR::HEADLESS::UNKNOWN_COMMAND " << line << std::endl;
+        }
+        Profiler::get().endFrame();
+    }
+    if (Profiler::get().isEnabled()) {
+        Profiler::get().report();
     }
 
-    // Block write to STDIN inheritance
-    SetHandleInformation(pyStd_IN_WR, HANDLE_FLAG_INHERIT, 0);
+    // Finish any outstanding GL work before the context goes away
+    glFinish();
+    csvHandler.printCacheStats(std::cout);
+    std::cout << "Closing..." << std::endl;
+    return 0;
+}
 
-    // Create the child process for Python (see https://learn.microsoft.com/en-us/windows/win32/procthread/creating-processes)
-    STARTUPINFO si;
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
-    si.hStdError = pyStd_OUT_WR; // Connect to the pre-defined pipes we made earlier
-    si.hStdOutput = pyStd_OUT_WR;
-    si.hStdInput = pyStd_IN_RD;
-    si.dwFlags |= STARTF_USESTDHANDLES;
-    ZeroMemory(&pi, sizeof(pi));
+// Render board states in bulk and export a row for each of them. Boards are read from stdin,
+// one per line (see Features::parseBoard), e.g. a boards file the game exported. Every batch is drawn into a single atlas framebuffer
+// in one pass and read back with a single glReadPixels.
+int runAtlas(const int tileSize) {
+    HeadlessContext context(tileSize, tileSize);
+    if (context.initFailed()) {
+        return -1;
+    }
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(HeadlessContext::getProcAddress))) {
+        return -1;
+    }
 
-    if (!CreateProcess(NULL, cmd.data(), NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi)) {
-        std::cerr << "[" << tid << "] " << "Failed to spawn subprocess" << std::endl;
-        return;
+    Renderer glRenderer = Renderer();
+    if (glRenderer.initFailed()) {
+        return -1;
+    }
+    CSVHandler csvHandler;
+    configureGL();
+
+    // Work out how many tiles fit in the largest framebuffer we're allowed to make
+    int maxRenderbufferSize = 0;
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+    const int tilesPerSide = std::min(maxRenderbufferSize, TTT::atlasMaxSize) / tileSize;
+    const size_t capacity = static_cast<size_t>(tilesPerSide) * tilesPerSide;
+    // Augmented boards add a tile for each of their symmetries, which all have to fit in the same batch
+    const size_t tilesPerBoard = augmentRows ? Symmetry::count : 1;
+    if (capacity < tilesPerBoard) {
+        std::cout << "ERROR::ATLAS::TILE_TOO_LARGE" << std::endl;
+        return -1;
     }
 
-    // Close handles unneeded by parent
-    CloseHandle(pyStd_OUT_WR);
-    CloseHandle(pyStd_IN_RD);
+    int columns = 0;
+    int rows = 0;
+    size_t total = 0;
+    bool done = false;
+    while (!done) {
+        // Gather a batch of boards. Their instances are freed all at once when the batch is done.
+        Arena::Scope batch;
+        std::vector<std::pmr::vector<Geometry::Instance>> tiles;
+        std::vector<int> moves;
+        std::vector<std::string> boards;
+        std::string line;
+        while (tiles.size() + tilesPerBoard <= capacity) {
+            if (!std::getline(std::cin, line)) {
+                done = true;
+                break;
+            }
+            GameState::Grid grid;
+            int move = -1;
+            if (!Features::parseBoard(line, grid, move)) {
+                if (!line.empty()) std::cout << "ERROR::ATLAS::INVALID_BOARD " << line << std::endl;
+                continue;
+            }
+            if (!augmentRows) {
+                tiles.push_back(Geometry::gridInstances(grid, batch.resource()));
+                moves.push_back(move);
+                boards.push_back(Features::formatBoard(grid, move));
+                continue;
+            }
+            for (const int symmetry : Symmetry::distinctVariants(grid, move, batch.resource())) {
+                const GameState::Grid variant = Symmetry::mapGrid(symmetry, grid);
+                tiles.push_back(Geometry::gridInstances(variant, batch.resource()));
+                moves.push_back(move >= 0 ? Symmetry::mapCell(symmetry, move) : move);
+                boards.push_back(Features::formatBoard(variant, moves.back()));
+            }
+        }
+        if (tiles.empty()) {
+            break;
+        }
 
-    // We're running!
-    std::cout << "[" << tid << "] " << "Model running..." << std::endl;
+        // Size the atlas from the first batch. Later batches are never larger.
+        if (columns == 0) {
+            columns = std::min(tilesPerSide, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(tiles.size())))));
+            rows = static_cast<int>((tiles.size() + columns - 1) / columns);
+            if (!glRenderer.createOffscreenTarget(tileSize * columns, tileSize * rows)) {
+                return -1;
+            }
+            std::cout << "Atlas is " << columns << "x" << rows << " tiles of " << tileSize << " pixels" << std::endl;
+        }
 
-    while(!killThread) {
-        // Read whatever python output may exist
-        readFromPython(pyStd_OUT_RD);
+        glRenderer.drawAtlas(tiles, tileSize, columns, rows);
+        csvHandler.exportRows(csvHandler.generateAtlasRowData(moves, tileSize, columns, rows), boards);
+        total += tiles.size();
+    }
 
-        // Process queue elements
-        {
-            std::cout << "[" << tid << "] " << "QUEUECHECK - Attempting to lock on queue" << std::endl;
-            const std::lock_guard<std::mutex> lock(queueLock); // We've now locked the message queue and can process safely
-            if (!msgQueue.empty()) {
-                while (!msgQueue.empty()) {
-                    writeToPython(pyStd_IN_WR, msgQueue.front());
-                    msgQueue.pop();
-                }
+    std::cout << "Exported " << total << " rows" << std::endl;
+    return 0;
+}
+
+// Play recorded sessions (see SessionLog) back as fast as they'll go, with no window and no model.
+// Clicks go through handleClick and the model's moves through playMove, just as they did live, and
+// in training mode every move's rows are exported again to outPath, drawn on the CPU with the current
+// feature extractor. path is a log or a folder of them.
+int runReplay(const std::string& path, const std::string& outPath) {
+    std::vector<std::filesystem::path> logs;
+    if (std::filesystem::is_directory(path)) {
+        for (const auto& entry : std::filesystem::directory_iterator(path)) {
+            if (entry.path().extension() == ".tttlog") {
+                logs.push_back(entry.path());
+            }
+        }
+        std::sort(logs.begin(), logs.end()); // Named by when they started
+    } else {
+        logs.push_back(path);
+    }
+
+    std::error_code error;
+    const std::filesystem::path outFolder = std::filesystem::path(outPath).parent_path();
+    if (!outFolder.empty()) {
+        std::filesystem::create_directories(outFolder, error);
+    }
+    CSVHandler csvHandler;
+    csvHandler.setCpuFeatures(true);
+    csvHandler.setLogPath(outPath);
+    if (!csvHandler.setPyramid(featurePyramid)) {
+        return -1;
+    }
+    quiet = true;
+
+    size_t sessions = 0;
+    size_t events = 0;
+    size_t games = 0;
+    size_t moves = 0;
+    size_t replies = 0;
+    size_t movedClicks = 0; // Clicks that land in a different cell now than they did live
+    double replyMs = 0.0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& log : logs) {
+        SessionLog::Header header;
+        std::vector<SessionLog::Event> recorded;
+        if (!SessionLog::read(log.string(), header, recorded)) {
+            continue;
+        }
+        if (header.rows != GameState::rows || header.cols != GameState::cols) {
+            std::cerr << "ERROR::REPLAY::WRONG_BOARD_SIZE " << log.string() << " is " << header.rows << "x" << header.cols << std::endl;
+            continue;
+        }
+        trainingMode = header.trainingMode;
+        csvHandler.setAugment(header.augment || augmentRows);
+        sessions++;
+        events += recorded.size();
+
+        GameState game;
+        std::uint64_t askedUs = 0;
+        for (const SessionLog::Event& event : recorded) {
+            const bool wasOver = game.isOver();
+            const int movesBefore = game.getMoveCount();
+            switch (event.type) {
+                case SessionLog::CLICK:
+                    if (!game.isOver() && Geometry::cellAt(event.x / event.width, event.y / event.height) != event.cell) {
+                        movedClicks++;
+                    }
+                    handleClick(sf::Vector2f{event.x, event.y}, sf::Vector2u{event.width, event.height}, game, csvHandler);
+                    break;
+                case SessionLog::KEY:
+                    // Wireframe (T) doesn't change features drawn on the CPU, and N is followed by the request it made
+                    if (event.key == 'R') {
+                        game.reset();
+                    } else if (event.key == 'M') {
+                        trainingMode = !trainingMode;
+                    }
+                    break;
+                case SessionLog::MODEL_REQUEST:
+                    askedUs = event.timeUs;
+                    break;
+                case SessionLog::MODEL_REPLY:
+                    // The live game asked again after an illegal move, and that request follows
+                    replies++;
+                    replyMs += (event.timeUs - askedUs) / 1000.0;
+                    if (event.cell >= 0 && game.canPlace(event.cell)) {
+                        playMove(game, event.cell);
+                    }
+                    break;
+                case SessionLog::FALLBACK_MOVE:
+                    playMove(game, event.cell);
+                    break;
             }
-        } // End of processing scope, we use this scope since the mutex is unlocked when it leaves scope
-
-        // Sleep
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    }
-
-    // Shutdown
-    writeToPython(pyStd_IN_WR, "shutdown"); // tell python to shutdown
-    std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Give python time to shutdown
-    readFromPython(pyStd_OUT_RD); // Read final Python output
-    int modelReturn = WaitForSingleObject(pi.hProcess, INFINITE);
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
-    CloseHandle(pyStd_OUT_RD);
-    CloseHandle(pyStd_IN_WR);
-    std::cout << "[" << tid << "] " << "Model subprocess exited with code " << modelReturn << std::endl;
+            moves += game.getMoveCount() > movesBefore;
+            games += !wasOver && game.isOver();
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Replayed " << sessions << " sessions (" << events << " events, " << moves << " moves, " << games << " finished games) in "
+              << seconds << " s (" << static_cast<size_t>(games / std::max(seconds, 1e-9)) << " games/s)" << std::endl;
+    if (replies > 0) {
+        std::cout << "The model answered " << replies << " requests, in " << replyMs / replies << " ms on average" << std::endl;
+    }
+    if (movedClicks > 0) {
+        std::cout << "WARNING::REPLAY::" << movedClicks << " clicks land in a different cell than they did live" << std::endl;
+    }
+    std::cout << "Rows exported to " << outPath << std::endl;
+    return 0;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Parse command line flags
+    bool headless = false;
+    bool atlas = false;
+    bool logSession = true;
+    std::string replayPath;
+    std::string replayOut = TTT::replayOutPath;
+    int tileSize = TTT::screenWidth;
+    std::string opponentSpec = "model";
+    std::string pyramidLevels;
+    int pyramidBits = 4;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--atlas") {
+            atlas = true;
+        } else if (arg == "--augment") {
+            augmentRows = true;
+        } else if (arg == "--validate-feature-cache" && i + 1 < argc) {
+            validateFeatureCache = std::max(0, atoi(argv[++i]));
+        } else if (arg == "--pyramid" && i + 1 < argc) {
+            pyramidLevels = argv[++i];
+        } else if (arg == "--pyramid-bits" && i + 1 < argc) {
+            pyramidBits = atoi(argv[++i]);
+        } else if (arg == "--no-session-log") {
+            logSession = false;
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            replayOut = argv[++i];
+        } else if (arg == "--opponent" && i + 1 < argc) {
+            // Who answers "N" in testing mode: the model, or a policy like selfplay's (e.g. search)
+            opponentSpec = argv[++i];
+            if (!isPolicySpec(opponentSpec)) {
+                std::cerr << "Unknown opponent: " << opponentSpec << std::endl;
+                return -1;
+            }
+        } else if (arg == "--tile-size" && i + 1 < argc) {
+            // Tiles smaller than the screen are much faster, but only approximate the screen's features
+            tileSize = atoi(argv[++i]);
+            if (tileSize <= 0 || tileSize % GameState::rows != 0 || tileSize % GameState::cols != 0) {
+                std::cerr << "Tile size must be a positive multiple of the board's rows and columns" << std::endl;
+                return -1;
+            }
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (!pyramidLevels.empty() && !Features::parsePyramid(pyramidLevels, pyramidBits, featurePyramid)) {
+        return -1;
+    }
+
+    // Replays don't need a window, or even OpenGL
+    if (!replayPath.empty()) {
+        return runReplay(replayPath, replayOut);
+    }
+
+    // Atlas mode is always headless
+    if (atlas) {
+        return runAtlas(tileSize);
+    }
+
+    // Headless mode drives the game from stdin and doesn't talk to the model
+    if (headless) {
+        return runHeadless();
+    }
+
     //*********************************************************
-    // Start machine learning model (Windows only)
+    // Start machine learning model
     //*********************************************************
-    std::thread mgr(runModel);
+    // It starts in the background and is supervised by the pool (heartbeats, timeouts and restarts).
+    // Until it's ready, and whenever it's down, moves come from the perfect policy instead.
+    // Any other opponent is played natively and the model isn't started.
+    std::unique_ptr<ModelPool> model;
+    if (opponentSpec == "model") {
+        model = std::make_unique<ModelPool>(1, TTT::modelCommand, true);
+        modelPool = model.get();
+    }
+    std::unique_ptr<Policy> fallbackPolicy = opponentSpec == "model" ? std::make_unique<PerfectPolicy>() : createPolicy(opponentSpec);
+    std::mt19937 rng(std::random_device{}());
+    ModelMove modelMove;
 
     //*********************************************************
     // Create the SFML window, OpenGL context, and setup GLAD
@@ -321,17 +614,26 @@ int main() {
         return -1;
     }
 
-    // Setup the game
+    // Setup the game and draw it as it's played
+    GameState game;
     GameBoard board = GameBoard(glRenderer);
+    game.setObserver(&board);
 
     // For handling our generate data to implement the ML model
     CSVHandler csvHandler;
+    csvHandler.setAugment(augmentRows);
+    csvHandler.setCacheValidation(validateFeatureCache);
+    if (!csvHandler.setPyramid(featurePyramid)) {
+        return -1;
+    }
 
-    // Enable debug output (see https://www.khronos.org/opengl/wiki/OpenGL_Error)
-    glEnable( GL_DEBUG_OUTPUT );
-    glDebugMessageCallback( MessageCallback, 0 );
-    glPixelStorei(GL_PACK_ROW_LENGTH, TTT::screenWidth); // Set to screenWidth number of pixels per row
-    glPixelStorei(GL_PACK_ALIGNMENT, 1); // Set to 1 byte pixel row alignment
+    configureGL();
+
+    // Record the session so it can be replayed (--replay)
+    SessionLog log;
+    if (logSession && log.open(SessionLog::defaultPath(), {GameState::rows, GameState::cols, trainingMode, augmentRows})) {
+        sessionLog = &log;
+    }
     
     //*********************************************************
     // Begin the main game loop
@@ -339,12 +641,16 @@ int main() {
 
     bool running = true;
     while (running) {
+        // Time the whole frame, including waiting on vsync in display()
+        auto frameStart = std::chrono::steady_clock::now();
+
         while (const std::optional event = window.pollEvent())
         {
             // TODO: Change these to callbacks
             if (event->is<sf::Event::Closed>())
             {
                 running = false;
+                if (sessionLog) sessionLog->key('Q');
             } 
 
             else if (const auto* mouse = event->getIf<sf::Event::MouseButtonPressed>()) {
@@ -352,96 +658,59 @@ int main() {
                     // Get the mouse position in window coordinates and hand off to handler 
                     sf::Vector2f mousePosWindow = window.mapPixelToCoords(sf::Mouse::getPosition(window));
                     std::cout << "Clicked: (" << mousePosWindow.x << "," << mousePosWindow.y << ")" << std::endl;
-                    int move = handleClick(mousePosWindow, window, board, csvHandler);
+                    int move = handleClick(mousePosWindow, window.getSize(), game, csvHandler);
                 }
             }
             
             else  if (const auto* key = event->getIf<sf::Event::KeyPressed>()) {
                 if (key->scancode == sf::Keyboard::Scancode::Escape) {
                     running = false;
+                    if (sessionLog) sessionLog->key('Q');
                 }
 
                 else if (key->scancode == sf::Keyboard::Scancode::R) {
-                    // Reset the game to the start
-                    board.reset();
+                    // Reset the game to the start, forgetting any move we were waiting on
+                    game.reset();
+                    modelMove.pending = false;
+                    if (sessionLog) sessionLog->key('R');
                 }
 
                 else if (key->scancode == sf::Keyboard::Scancode::T) {
                     // Toggle wireframe draw
                     glRenderer.toggleWireframe();
+                    csvHandler.setWireframe(glRenderer.isWireframe());
+                    if (sessionLog) sessionLog->key('T');
+                }
+
+                else if (key->scancode == sf::Keyboard::Scancode::P) {
+                    // Toggle the frame profiler
+                    Profiler::get().toggle();
+                    if (sessionLog) sessionLog->key('P');
                 }
 
                 else if (key->scancode == sf::Keyboard::Scancode::M) {
                     trainingMode = !trainingMode;
                     std::cout << "TRAINING MODE = " << trainingMode << std::endl;
+                    if (sessionLog) sessionLog->key('M');
                 }
 
                 else if (!trainingMode && key->scancode == sf::Keyboard::Scancode::N) {
-                    if (!board.isOver()) { // Why would you ask for a move after the game ends
-                        std::cout << "Asking AI for move..." << std::endl; 
-                        {
-                            std::cout << "AIREQUEST - Attempting to lock on queue" << std::endl;
-                            const std::lock_guard<std::mutex> lock(queueLock); // we are now locked until lock goes out of scope
-                            msgQueue.push(std::string("RQSTMV[" + csvHandler.generateRowData(-1) + "]&" + std::to_string(0)));
-                        }
+                    if (!game.isOver() && !modelMove.pending) { // Why would you ask for a move after the game ends
+                        std::cout << "Asking AI for move..." << std::endl;
+                        if (sessionLog) sessionLog->key('N');
+                        modelMove.attempts = 0;
+                        requestModelMove(modelMove, game, csvHandler, *fallbackPolicy, rng);
                     }
                 }
             }
         }
 
         // Update board if the model has made a move
-        if (g_cellMove >= 0) {
-            int tempMove = -1;
-            {
-                // Read and reset the cell move value
-                std::cout << "FIRSTAIMOVE - Attempting to lock on move" << std::endl;
-                const std::lock_guard<std::mutex> lock(moveLock);
-                tempMove = g_cellMove;
-                g_cellMove = -1;
-            }
+        updateModelMove(modelMove, game, csvHandler, *fallbackPolicy, rng);
 
-            // Check if we can place
-            if (board.canPlace(tempMove)) {
-                playMove(board, tempMove);
-            } else {
-                // Otherwise, request a move (blocking) over and over again until we find a valid one
-                bool found = false;
-                int attempts = 0;
-                bool receivedResp = true;
-                while (!found) {
-                    std::cout << "Model returned a bad value " << tempMove << ". Trying again: Attempt: " << attempts << std::endl;
-                    {
-                        // Publish a request
-                        std::cout << "UPDATE - Attempting to lock on queue" << std::endl;
-                        const std::lock_guard<std::mutex> lock(queueLock);
-                        if (receivedResp) { // Only publish a message if we aren't currently working on one
-                            std::cout << "Empty message queue. Making request..." << std::endl;
-                            msgQueue.push(std::string("RQSTMV[" + csvHandler.generateRowData(-1) + "]&" + std::to_string(attempts)));
-                            receivedResp = false;
-                        }
-                    }
-                    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                    {
-                        // See if we have a valid choice
-                        std::cout << "UPDATE - Attempting to lock on move" << std::endl;
-                        const std::lock_guard<std::mutex> lock(moveLock);
-                        if (g_cellMove >= 0) {
-                            receivedResp = true; // we have now received a response, so see if we can play it
-                            if (board.canPlace(g_cellMove)) {
-                                std::cout << "Finally found a move on attempt " << attempts << ". Playing " << g_cellMove << std::endl;
-                                found = true;
-                                playMove(board, g_cellMove);
-                            } else {
-                                attempts += 1;
-                                std::cout << "Bad response: " << g_cellMove << std::endl;
-                            }
-                        } else {
-                            std::cout << "Move not ready yet: " << g_cellMove << std::endl;
-                        }
-                        g_cellMove = -1; // reset g_cellMove to force a new value
-                    }
-                }
-            }
+        // Pick up any edits to the shaders. Boards captured with the old ones may look different now.
+        if (glRenderer.pollShaderReload()) {
+            csvHandler.clearFeatureCache();
         }
 
         // Draw the TicTacToe board on the screen
@@ -449,10 +718,17 @@ int main() {
 
         // End the frame (internally swaps front and back buffers)
         window.display();
+
+        Profiler::get().record("frame", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+        Profiler::get().endFrame();
     }
 
     // Clean up & release resources
+    csvHandler.printCacheStats(std::cout);
     std::cout << "Closing..." << std::endl;
-    killThread = true;
-    mgr.join();
+    modelPool = nullptr;
+    sessionLog = nullptr;
+    if (model) {
+        model->printStats(std::cout);
+    }
 }
\ No newline at end of file
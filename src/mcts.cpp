@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "mcts.h"
+
+namespace {
+    // The winner of a finished game as a shape, or -1 for a draw
+    template <typename Game>
+    int outcome(const Game& game) {
+        switch (game.getStatus()) {
+            case GameTypes::X_WIN:
+                return GameTypes::X;
+            case GameTypes::C_WIN:
+                return GameTypes::CIRCLE;
+            default:
+                return -1;
+        }
+    }
+
+    template <typename Game>
+    GameTypes::CellState toMove(const Game& game) {
+        return game.getTurn() == 0 ? GameTypes::X : GameTypes::CIRCLE;
+    }
+}
+
+template <typename Game>
+MctsEngine<Game>::MctsEngine(const int threads, const int budgetMs, const Rollout rollout, const int maxNodes)
+    : threads(std::max(1, threads)), budgetMs(budgetMs), rolloutType(rollout),
+      nodes(new Node[std::max(1, maxNodes)]), capacity(static_cast<std::uint32_t>(std::max(1, maxNodes))) {
+    if (this->threads > 1) {
+        pool = std::make_unique<ThreadPool>(this->threads);
+    }
+}
+
+template <typename Game>
+bool MctsEngine<Game>::expand(Node& node, const Game& game) {
+    // Only one thread gets to add the children
+    std::uint8_t expected = UNEXPANDED;
+    if (!node.state.compare_exchange_strong(expected, EXPANDING, std::memory_order_acquire)) {
+        return expected == EXPANDED;
+    }
+
+    // Claim a block of the arena for them
+    const std::uint32_t count = static_cast<std::uint32_t>(Game::cells - game.getMoveCount());
+    std::uint32_t first = used.load(std::memory_order_relaxed);
+    do {
+        if (first + count > capacity) {
+            node.state.store(UNEXPANDED, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!used.compare_exchange_weak(first, first + count, std::memory_order_relaxed));
+
+    std::uint32_t child = first;
+    for (int cell = 0; cell < Game::cells; cell++) {
+        if (game.canPlace(cell)) {
+            nodes[child].move = static_cast<std::int8_t>(cell);
+            nodes[child].mover = static_cast<std::int8_t>(toMove(game));
+            child++;
+        }
+    }
+
+    // Everything above is visible to any thread that sees EXPANDED
+    node.childCount = static_cast<std::uint8_t>(count);
+    node.firstChild.store(first, std::memory_order_relaxed);
+    node.state.store(EXPANDED, std::memory_order_release);
+    return true;
+}
+
+template <typename Game>
+std::uint32_t MctsEngine<Game>::selectChild(const Node& node) const {
+    const std::uint32_t first = node.firstChild.load(std::memory_order_relaxed);
+    const double logParent = std::log(static_cast<double>(std::max(1, node.visits.load(std::memory_order_relaxed))));
+    std::uint32_t best = first;
+    double bestValue = -std::numeric_limits<double>::infinity();
+    for (std::uint32_t i = first; i < first + node.childCount; i++) {
+        const int visits = nodes[i].visits.load(std::memory_order_relaxed);
+        if (visits == 0) {
+            return i;
+        }
+        const double value = nodes[i].score.load(std::memory_order_relaxed) / (2.0 * visits)
+            + TTT::mctsExploration * std::sqrt(logParent / visits);
+        if (value > bestValue) {
+            bestValue = value;
+            best = i;
+        }
+    }
+    return best;
+}
+
+template <typename Game>
+int MctsEngine<Game>::rollout(Game game, std::mt19937& rng) const {
+    std::array<int, Game::cells> empty;
+    while (!game.isOver()) {
+        int count = 0;
+        for (int cell = 0; cell < Game::cells; cell++) {
+            if (game.canPlace(cell)) {
+                empty[count++] = cell;
+            }
+        }
+
+        int move = -1;
+        if (rolloutType == GUIDED) {
+            // Win if we can, otherwise stop the opponent winning
+            const GameTypes::CellState mine = toMove(game);
+            const GameTypes::CellState theirs = mine == GameTypes::X ? GameTypes::CIRCLE : GameTypes::X;
+            for (int i = 0; i < count && move < 0; i++) {
+                if (game.winsAt(empty[i], mine)) {
+                    move = empty[i];
+                }
+            }
+            for (int i = 0; i < count && move < 0; i++) {
+                if (game.winsAt(empty[i], theirs)) {
+                    move = empty[i];
+                }
+            }
+        }
+        if (move < 0) {
+            move = empty[std::uniform_int_distribution<int>(0, count - 1)(rng)];
+        }
+        game.playMove(move);
+    }
+    return outcome(game);
+}
+
+template <typename Game>
+void MctsEngine<Game>::iterate(const Game& root, std::mt19937& rng) {
+    Game game = root;
+    std::array<std::uint32_t, Game::cells + 1> path;
+    int length = 0;
+    std::uint32_t index = 0;
+    path[length++] = index;
+    nodes[index].visits.fetch_add(TTT::mctsVirtualLoss, std::memory_order_relaxed);
+
+    // Walk down the tree until we step onto a node nobody has visited yet
+    while (!game.isOver()) {
+        Node& node = nodes[index];
+        if (node.state.load(std::memory_order_acquire) != EXPANDED && !expand(node, game)) {
+            break; // Play out from here instead
+        }
+        index = selectChild(node);
+        Node& child = nodes[index];
+        game.playMove(child.move);
+        path[length++] = index;
+        if (child.visits.fetch_add(TTT::mctsVirtualLoss, std::memory_order_relaxed) == 0) {
+            break;
+        }
+    }
+
+    // Swap every virtual loss on the path for the real result
+    const int winner = game.isOver() ? outcome(game) : rollout(game, rng);
+    for (int i = 0; i < length; i++) {
+        Node& node = nodes[path[i]];
+        node.score.fetch_add(winner < 0 ? 1 : winner == node.mover ? 2 : 0, std::memory_order_relaxed);
+        node.visits.fetch_add(1 - TTT::mctsVirtualLoss, std::memory_order_relaxed);
+    }
+}
+
+template <typename Game>
+int MctsEngine<Game>::chooseMove(const Game& game, std::mt19937& rng) {
+    if (game.isOver()) {
+        return -1;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::milliseconds(budgetMs);
+
+    // Start from an empty arena. Only the nodes the last search used need clearing.
+    for (std::uint32_t i = 0; i < used.load(); i++) {
+        Node& node = nodes[i];
+        node.visits.store(0, std::memory_order_relaxed);
+        node.score.store(0, std::memory_order_relaxed);
+        node.firstChild.store(0, std::memory_order_relaxed);
+        node.state.store(UNEXPANDED, std::memory_order_relaxed);
+        node.childCount = 0;
+        node.move = -1;
+        node.mover = GameTypes::CLEAR;
+    }
+    used = 1;
+    iterations = 0;
+
+    // The copy has no observer, so nothing we try is drawn
+    const Game root = game;
+    auto search = [this, &root, deadline](const std::uint32_t seed) {
+        std::mt19937 local(seed);
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (iterations.fetch_add(1, std::memory_order_relaxed) >= maxIterations && maxIterations > 0) {
+                break;
+            }
+            iterate(root, local);
+        }
+    };
+    if (pool) {
+        for (int i = 0; i < threads; i++) {
+            const std::uint32_t seed = rng();
+            pool->submit([&search, seed](const int) {search(seed);});
+        }
+        pool->wait();
+    } else {
+        search(rng());
+    }
+
+    // Play the move we tried most, which is more reliable than the best average
+    const Node& rootNode = nodes[0];
+    int move = -1;
+    int mostVisits = -1;
+    if (rootNode.state.load(std::memory_order_acquire) == EXPANDED) {
+        const std::uint32_t first = rootNode.firstChild.load(std::memory_order_relaxed);
+        for (std::uint32_t i = first; i < first + rootNode.childCount; i++) {
+            const int visits = nodes[i].visits.load(std::memory_order_relaxed);
+            if (visits > mostVisits) {
+                mostVisits = visits;
+                move = nodes[i].move;
+            }
+        }
+    }
+
+    // Threads that stopped at the limit counted one playout too many
+    stats.iterations = maxIterations > 0 ? std::min(iterations.load(), maxIterations) : iterations.load();
+    stats.nodes = used.load();
+    stats.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return move;
+}
+
+template <typename Game>
+std::vector<int> MctsEngine<Game>::rootVisits() const {
+    std::vector<int> result(Game::cells, 0);
+    const Node& rootNode = nodes[0];
+    if (rootNode.state.load(std::memory_order_acquire) == EXPANDED) {
+        const std::uint32_t first = rootNode.firstChild.load(std::memory_order_relaxed);
+        for (std::uint32_t i = first; i < first + rootNode.childCount; i++) {
+            result[nodes[i].move] = nodes[i].visits.load(std::memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+// The board sizes we build (see the bottom of gameState.cpp)
+template class MctsEngine<BasicGameState<3, 3, 3>>;
+template class MctsEngine<BasicGameState<4, 4, 4>>;
+template class MctsEngine<BasicGameState<5, 5, 4>>;
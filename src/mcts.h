@@ -0,0 +1,102 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "constants.h"
+#include "gameState.h"
+#include "threadPool.h"
+
+template <typename Game>
+class MctsEngine {
+    // Monte Carlo tree search. Every iteration walks down the tree picking children by UCT (their
+    // average result plus a bonus for being tried less), adds the children of the first position it
+    // reaches that has been visited before, plays the game out from the new position, and adds
+    // the result to every position on the way down.
+    // Playouts are random, or guided: take a win if there is one, otherwise block the opponent's
+    // win, otherwise play randomly. The search runs until its time budget is spent, on as many
+    // threads as it's given, all sharing one tree. While a thread is playing out a path, that path
+    // counts TTT::mctsVirtualLoss extra visits that scored nothing, so the other threads look elsewhere.
+    // Nodes live in an arena allocated once: a node's children are one block, handed out with an atomic
+    // bump of the arena's end, and published with an atomic store, so threads never take a lock.
+    // Unlike alpha-beta it gives an answer whenever it's stopped, which suits boards too big to search
+    // to the end. Templated on the game state; the sizes in gameState.cpp are instantiated in mcts.cpp.
+    public:
+        enum Rollout {
+            RANDOM = 0,
+            GUIDED = 1
+        };
+
+        // Playouts, nodes in the tree, and the time the last search took
+        struct Stats {
+            std::uint64_t iterations = 0;
+            std::uint32_t nodes = 0;
+            double elapsedMs = 0.0;
+        };
+
+        explicit MctsEngine(const int threads = 1, const int budgetMs = TTT::mctsBudgetMs, const Rollout rollout = GUIDED, const int maxNodes = TTT::mctsMaxNodes);
+
+        MctsEngine(const MctsEngine&) = delete;
+        MctsEngine& operator=(const MctsEngine&) = delete;
+
+        // Search from a position and return the most visited move, or -1 if the game is over
+        int chooseMove(const Game& game, std::mt19937& rng);
+
+        // Stop after this many playouts even if there's time left (0 for no limit), e.g. for repeatable benchmarks
+        void setMaxIterations(const std::uint64_t iterations) {maxIterations = iterations;}
+
+        // How many times the last search visited each move (0 for illegal moves)
+        std::vector<int> rootVisits() const;
+
+        const Stats& getStats() const {return stats;}
+
+    private:
+        enum NodeState : std::uint8_t {
+            UNEXPANDED = 0,
+            EXPANDING = 1, // Another thread is adding its children
+            EXPANDED = 2
+        };
+
+        struct Node {
+            std::atomic<std::int32_t> visits = 0; // Playouts through here, plus virtual losses still in progress
+            std::atomic<std::int32_t> score = 0; // Half points for whoever moved into this node: 2 for a win, 1 for a draw
+            std::atomic<std::uint32_t> firstChild = 0; // Index of the first child. The root is 0, so never a child.
+            std::atomic<std::uint8_t> state = UNEXPANDED;
+            std::uint8_t childCount = 0;
+            std::int8_t move = -1;
+            std::int8_t mover = GameTypes::CLEAR; // Who moved into this node
+        };
+
+        // One playout from the root: select, expand, roll out, and back up the result
+        void iterate(const Game& root, std::mt19937& rng);
+
+        // Give a node a child for every legal move. Returns false if it can't be expanded now
+        // (another thread is doing it, or the arena is full).
+        bool expand(Node& node, const Game& game);
+
+        // The child with the best UCT score, or the first child nobody has visited
+        std::uint32_t selectChild(const Node& node) const;
+
+        // Play the game out and return the winning shape, or -1 for a draw
+        int rollout(Game game, std::mt19937& rng) const;
+
+        int threads;
+        int budgetMs;
+        Rollout rolloutType;
+        std::uint64_t maxIterations = 0;
+
+        std::unique_ptr<Node[]> nodes;
+        std::uint32_t capacity;
+        std::atomic<std::uint32_t> used = 0;
+        std::atomic<std::uint64_t> iterations = 0;
+
+        // Only created for more than one thread. One thread searches on the caller's.
+        std::unique_ptr<ThreadPool> pool;
+        Stats stats;
+};
+
+#endif
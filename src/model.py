@@ -6,58 +6,242 @@ from sklearn.metrics import confusion_matrix
 from sklearn.metrics import accuracy_score
 from sklearn.tree import DecisionTreeClassifier
 from sklearn.neural_network import MLPClassifier
+from collections import Counter
+from rowparse import parse_log_bytes, parse_frame, parse_cells
 import numpy as np
 import random
+import io
+import os
+import pickle
+import hashlib
+import time
 
 #############
 ### TRAIN ###
 #############
 
-def sanitize_features(features):
-    # Convert features from hex to decimal
-    for row in range(len(features)):
-        for x in range(len(features[row])):
-            # Check if we're handling a base 10 digit or a base 16 digit (A-F)
-            if not str(features[row][x]).isdigit(): 
-                features[row][x] = int(features[row][x], 16) # Convert from hex to an integer
-            else:
-                features[row][x] = int(features[row][x]) # Ensure we're working with integers
+def read_rows_from(csv_filepath, offset):
+    # Read only the complete rows after a byte offset (0 means the whole file).
+    # Returns the features, the moves and the offset just after the last row.
+    # Features are parsed straight from the bytes of the file (see rowparse.py).
+    with open(csv_filepath, "rb") as f:
+        header = f.readline()
+        names = header.decode().strip().split(",")
+        f.seek(max(offset, len(header)))
+        chunk = f.read()
+    # A row still being written doesn't end in a newline yet, leave it for next time
+    end = chunk.rfind(b"\n") + 1
+    new_offset = max(offset, len(header)) + end
+    if end == 0:
+        features, classes = parse_log_bytes(b"")
+        return features, classes, new_offset
+    if "count" not in names:
+        features, classes = parse_log_bytes(chunk[:end])
+        return features, classes, new_offset
+
+    # A compacted log (see the compact tool) has a count column saying how many times each row was seen.
+    # Rows vary in width so pandas splits them up. The MLP can't weight samples, so expand every row
+    # back out. Reading the compacted file is still much faster than reading every row from the CSV.
+    data = read_csv(io.BytesIO(chunk[:end]), header=None, names=names)
+    features, classes = parse_frame(data)
+    counts = data["count"].values.astype(int)
+    features = np.repeat(features, counts, axis=0)
+    classes = np.repeat(classes, counts, axis=0)
+    print("[PYTHON] Expanded", len(counts), "compacted rows to", len(classes), "rows")
+    return features, classes, new_offset
+
+def train_from_scratch(features, classes):
+
+    # Train and test our model using 2-fold cross-validation
+    model = DecisionTreeClassifier()
+    x_fold1, x_fold2, y_fold1, y_fold2 = train_test_split(features, classes, test_size=0.5, random_state=0)
+    model.fit(x_fold1, y_fold1)
+    prediction1 = model.predict(x_fold2)
+    model.fit(x_fold2, y_fold2)
+    prediction2 = model.predict(x_fold1)
+
+    # Join results
+    actual = np.concatenate([y_fold2, y_fold1])
+    predicted = np.concatenate([prediction1, prediction2])
+
+    # Output confusion matrix, accuracy score
+    print("[PYTHON] Confusion matrix:\n", confusion_matrix(actual, predicted))
+    print("[PYTHON] Accuracy:", accuracy_score(actual, predicted))
+
+    # Now that we have this baseline, train the model on ALL the input data
+    model = MLPClassifier()
+    model.fit(features, classes)
+    return model
+
+def can_update(model, classes):
+    # partial_fit can only learn moves the model already knows about
+    return set(np.unique(classes)).issubset(set(model.classes_))
+
+def hash_log(offset):
+    # Hash the first offset bytes of the log. This is much quicker than parsing them.
+    digest = hashlib.sha256()
+    with open(csv_filepath, "rb") as f:
+        remaining = offset
+        while remaining > 0:
+            block = f.read(min(remaining, 1 << 20))
+            if not block:
+                break
+            digest.update(block)
+            remaining -= len(block)
+    return digest.hexdigest()
+
+def save_checkpoint(model, offset):
+    # The checkpoint is keyed by a hash of the data it was trained on (and the options that change training)
+    global checkpoint_hash
+    checkpoint = {"hash": hash_log(offset), "offset": offset, "options": training_options, "model": model}
+    checkpoint_hash = checkpoint["hash"]
+
+    # Write to a temporary file first so a crash never leaves a broken checkpoint.
+    # Several model processes may share a checkpoint (e.g. selfplay), so each has its own temporary file.
+    temp_path = checkpoint_path + "." + str(os.getpid()) + ".tmp"
+    with open(temp_path, "wb") as f:
+        pickle.dump(checkpoint, f)
+    os.replace(temp_path, checkpoint_path)
+    export_weights(model)
+
+def export_weights(model):
+    # The MLP's weights as text, so the C++ side can run the model without us (see nativeModel.h)
+    lines = ["TTTMLP 1", model.activation, model.out_activation_, " ".join(str(int(c)) for c in model.classes_), str(len(model.coefs_))]
+    for weights, biases in zip(model.coefs_, model.intercepts_):
+        lines.append(str(weights.shape[0]) + " " + str(weights.shape[1]))
+        lines.append(" ".join(repr(float(w)) for w in weights.ravel()))
+        lines.append(" ".join(repr(float(b)) for b in biases))
+    temp_path = weights_path + "." + str(os.getpid()) + ".tmp"
+    with open(temp_path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    os.replace(temp_path, weights_path)
+
+def load_checkpoint():
+    try:
+        with open(checkpoint_path, "rb") as f:
+            checkpoint = pickle.load(f)
+    except Exception:
+        return None
+
+    # Only usable if the start of the log is exactly what the model was trained on.
+    # A compacted log is rewritten rather than appended to, so it has to match completely.
+    size = os.path.getsize(csv_filepath)
+    offset = checkpoint.get("offset", 0)
+    if offset > size or (compacted and offset != size):
+        return None
+    if checkpoint.get("options") != training_options or checkpoint.get("hash") != hash_log(offset):
+        return None
+    return checkpoint
+
+def forget_checkpoint():
+    # Several model processes may share a checkpoint (e.g. selfplay), and each of them gets here on shutdown.
+    # Only remove it if it's still the one we loaded or saved, not one another process has saved since.
+    try:
+        with open(checkpoint_path, "rb") as f:
+            stored = pickle.load(f)
+        if stored.get("hash") == checkpoint_hash and stored.get("options") == training_options:
+            os.remove(checkpoint_path)
+    except FileNotFoundError:
+        pass # Another process got there first
+    except Exception:
+        pass # Unreadable, so load_checkpoint won't use it either
 
 # Read our CSV data
+start_time = time.perf_counter()
 csv_filepath = sys.argv[1]
 print("[PYTHON] CSV PATH: ", csv_filepath)
-data = read_csv(csv_filepath)
+compacted = "count" in read_csv(csv_filepath, nrows=0).columns
+training_options = [arg for arg in sys.argv[2:] if arg == "--dedupe"]
+
+# The fitted model is saved next to the log along with how far through the log it has read
+# and a hash of everything up to there. On launch, if the log still starts with exactly that
+# data we load the model and only learn the rows added since (often none, so we're ready
+# straight away), instead of cross-validating and retraining from scratch.
+# Each log has its own checkpoint and weights, named after it (out_log.csv -> out_log_checkpoint.pkl),
+# so models of different logs in the same folder don't overwrite each other's.
+log_stem = os.path.splitext(os.path.abspath(csv_filepath))[0]
+checkpoint_path = log_stem + "_checkpoint.pkl"
+weights_path = log_stem + "_weights.txt"
+checkpoint = None if "--retrain" in sys.argv[2:] else load_checkpoint()
+checkpoint_hash = None if checkpoint is None else checkpoint["hash"]
+model = None
+if checkpoint is not None:
+    model = checkpoint["model"]
+    offset = checkpoint["offset"]
+    classes = []
+    if offset < os.path.getsize(csv_filepath):
+        features, classes, offset = read_rows_from(csv_filepath, offset)
+    if len(classes) == 0:
+        print("[PYTHON] Loaded checkpoint, no new rows")
+    else:
+        if can_update(model, classes):
+            model.partial_fit(features, classes)
+            print("[PYTHON] Loaded checkpoint, learned", len(classes), "new rows")
+        else:
+            print("[PYTHON] New rows have moves the checkpoint hasn't seen, retraining")
+            model = None
 
-# Prep our data arrays (a lot of this follows what we've been doing in the programming assignments)
-features = data.values[:, 0:9]
-classes = data.values[:, 9]
+if model is None:
+    features, classes, offset = read_rows_from(csv_filepath, 0)
 
-# Perform conversions so features array is valid
-sanitize_features(features)
+    # Optionally keep only one copy of each identical row (same features, same move).
+    # Rotations and reflections of a board can't be matched here since the features don't
+    # rotate with the board, so symmetric rows are deduplicated in C++ (selfplay --dedupe).
+    if "--dedupe" in sys.argv[2:]:
+        before = len(classes)
+        rows = np.unique(np.column_stack([features, classes]), axis=0)
+        features, classes = rows[:, 0:9], rows[:, 9]
+        print("[PYTHON] Dropped", before - len(classes), "duplicate rows")
 
-# Ensure classes are integers too
-classes = classes.astype(int)
+    model = train_from_scratch(features, classes)
+    save_checkpoint(model, offset)
+elif offset != checkpoint["offset"]:
+    save_checkpoint(model, offset)
+elif not os.path.exists(weights_path):
+    export_weights(model)
 
-# Train and test our model using 2-fold cross-validation
-model = DecisionTreeClassifier()
-x_fold1, x_fold2, y_fold1, y_fold2 = train_test_split(features, classes, test_size=0.5, random_state=0)
-model.fit(x_fold1, y_fold1)
-prediction1 = model.predict(x_fold2)
-model.fit(x_fold2, y_fold2)
-prediction2 = model.predict(x_fold1)
+# Rows the game sent us with TRAIN during this session. The game also appends them to the log,
+# so they're skipped when catching the checkpoint up to the end of the log on shutdown.
+learned_rows = Counter()
 
-# Join results
-actual = np.concatenate([y_fold2, y_fold1])
-predicted = np.concatenate([prediction1, prediction2])
+def row_key(features, move):
+    # Rows are matched by their parsed values, so "a" and "A" count as the same row
+    return features.tobytes() + bytes([int(move)])
 
-# Output confusion matrix, accuracy score
-print("[PYTHON] Confusion matrix:\n", confusion_matrix(actual, predicted))
-print("[PYTHON] Accuracy:", accuracy_score(actual, predicted))
+def learn_row(row):
+    # Learn a single row straight away. Returns False if it can't be learned incrementally.
+    features = parse_cells(row)
+    classes = np.array([int(row[9])], dtype=np.uint8)
+    if not can_update(model, classes):
+        return False
+    model.partial_fit(features, classes)
+    learned_rows[row_key(features[0], classes[0])] += 1
+    return True
 
-# Now that we have this baseline, train the model on ALL the input data
-model = MLPClassifier()
-model.fit(features, classes)
+def catch_up_and_save():
+    # Learn any rows in the log we haven't seen (e.g. from headless mode), then save
+    global offset
+    if compacted:
+        return
+    features, classes, offset = read_rows_from(csv_filepath, offset)
+    unseen = np.ones(len(classes), dtype=bool)
+    if len(learned_rows) > 0:
+        for i in range(len(classes)):
+            key = row_key(features[i], classes[i])
+            if learned_rows[key] > 0:
+                learned_rows[key] -= 1
+                unseen[i] = False
+    if unseen.any():
+        features, classes = features[unseen], classes[unseen]
+        if not can_update(model, classes):
+            # Some moves need a full retrain, which happens on the next launch without a checkpoint
+            print("[PYTHON] The log has moves the model hasn't seen, it will retrain on the next launch")
+            forget_checkpoint()
+            return
+        model.partial_fit(features, classes)
+    save_checkpoint(model, offset)
 
+print("[PYTHON] Startup took", round(time.perf_counter() - start_time, 3), "s")
 print("[PYTHON] READY")
 sys.stdout.flush()
 
@@ -67,10 +251,9 @@ def request_move(request, attempts):
         return random.choice(range(9)) # Can only make moves for 0-8 (there are only 9 cells)
 
     # Remove the label from the row data (should be -1, invalid anyway). We have 9 features.
-    # Also create a 2D list as this is what the model expects.
-    req = [list(request[0:9])]
-    print("[PYTHON] list: ", req) 
-    sanitize_features(req) # Prepare features
+    # parse_cells makes the 1 x 9 array the model expects.
+    req = parse_cells(request) # Prepare features
+    print("[PYTHON] list: ", req.tolist())
     result = model.predict(req) # will return an array
     return result[0]
 
@@ -81,11 +264,34 @@ shutdown = False
 while (not shutdown):
     for line in sys.stdin:
         line = str(line.strip())
-        if "shutdown" in line:
+        if line == "PING":
+            # Heartbeat from the game, so it knows we're still alive
+            print("[PYTHON] PONG")
+            sys.stdout.flush()
+        elif "shutdown" in line:
             shutdown = True
+            catch_up_and_save()
             print("[PYTHON] Shutting down...")
             sys.stdout.flush()
             break
+        elif "TRAIN" in line:
+            # A row the game just exported: TRAIN[f1,...,f9,move]
+            row = str(line)[int(line.index("[")) + 1:int(line.index("]"))].split(",")
+            if learn_row(row):
+                print("[PYTHON] TRAINED", row[9])
+            else:
+                print("[PYTHON] Can't learn move", row[9], "without retraining, it will be learned on the next launch")
+            sys.stdout.flush()
+        elif "RQSTBATCH" in line:
+            # Many boards at once: RQSTBATCH[f1,...,f9,-1;f1,...,f9,-1;...]. One predict call for all of them
+            # is far quicker than a request each (e.g. for scoring every position), and the moves go back
+            # in one line, RSPBATCH m1,m2,... These are the model's first choices, legal or not.
+            boards = line[line.index("[") + 1:line.index("]")].split(";")
+            requests = np.vstack([parse_cells(board.split(",")) for board in boards])
+            moves = model.predict(requests)
+            print("[PYTHON] Batch of", len(boards), "requests")
+            print("[PYTHON] RSPBATCH", ",".join(str(int(move)) for move in moves))
+            sys.stdout.flush()
         elif "RQSTMV" in line:
             # The following line converts line to a str, then reduces it from the [ (+1 in order to not include the [) to the ], then 
             # delimits in by a , to create a list.
@@ -106,3 +312,8 @@ while (not shutdown):
         else:
             print("[PYTHON] Received: ", line)
             sys.stdout.flush()
+    else:
+        # The game closed our input, so it's gone. Treat it like a shutdown.
+        if not shutdown:
+            shutdown = True
+            catch_up_and_save()
@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "modelPool.h"
+#include "constants.h"
+
+namespace {
+    double millisecondsSince(const std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+ModelPool::ModelPool(const int workerCount, const std::string& command, const bool echo) : command(command), echo(echo), created(std::chrono::steady_clock::now()) {
+    for (int i = 0; i < std::max(1, workerCount); i++) {
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->index = i;
+        workers.back()->backoffMs = TTT::modelRestartMinMs;
+    }
+    for (auto& worker : workers) {
+        worker->thread = std::thread(&ModelPool::workerLoop, this, std::ref(*worker));
+    }
+}
+
+ModelPool::~ModelPool() {
+    // Workers finish what's queued before shutting their model down.
+    // Taking each lock means nobody can miss this between checking and going to sleep.
+    stopping = true;
+    {
+        const std::lock_guard<std::mutex> lock(readyLock);
+    }
+    readyChanged.notify_all();
+    for (auto& worker : workers) {
+        {
+            const std::lock_guard<std::mutex> lock(worker->lock);
+        }
+        worker->wake.notify_all();
+    }
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+bool ModelPool::readUntil(Worker& worker, const std::string& marker, const int timeoutMs, std::string& line) {
+    // One deadline for the whole reply, so a chatty model can't stretch it out
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0 || !worker.process.readLine(line, static_cast<int>(remaining))) {
+            return false;
+        }
+        worker.lastHeard = std::chrono::steady_clock::now();
+        if (echo) {
+            std::cout << "[MODEL " << worker.index << "] " << line << std::endl;
+        }
+        if (line.find(marker) != std::string::npos) {
+            return true;
+        }
+    }
+}
+
+bool ModelPool::startProcess(Worker& worker) {
+    if (worker.started) {
+        const std::lock_guard<std::mutex> lock(worker.lock);
+        worker.stats.restarts++;
+    }
+    worker.started = true;
+    if (!worker.process.start(command)) {
+        std::cerr << "ERROR::MODEL_POOL::SPAWN_FAILED" << std::endl;
+        return false;
+    }
+
+    // Wait for the model to finish training (or load its checkpoint). Give up early if we're
+    // shutting down, rather than waiting minutes for a model nobody will ask anything.
+    const auto start = std::chrono::steady_clock::now();
+    std::string line;
+    while (!stopping && millisecondsSince(start) < TTT::modelStartTimeoutMs) {
+        if (readUntil(worker, "READY", 100, line)) {
+            std::cout << "Model worker " << worker.index << " time to READY: " << millisecondsSince(start) << " ms" << std::endl;
+            {
+                const std::lock_guard<std::mutex> lock(readyLock);
+                worker.ready = true;
+            }
+            readyChanged.notify_all();
+            return true;
+        }
+        if (!worker.process.isRunning()) {
+            break;
+        }
+    }
+    if (!stopping) {
+        std::cerr << "ERROR::MODEL_POOL::NOT_READY" << std::endl;
+    }
+    return false;
+}
+
+void ModelPool::stopProcess(Worker& worker, const std::string& reason) {
+    worker.ready = false;
+    worker.process.kill();
+    const int code = worker.process.close();
+    if (stopping) {
+        return; // Anything still queued is failed by the worker loop on its way out
+    }
+    std::cerr << "ERROR::MODEL_POOL::" << reason << " worker " << worker.index << " (exit code " << code
+              << "), restarting in " << worker.backoffMs << " ms" << std::endl;
+
+    // Back off further every time in a row it fails
+    worker.nextStart = std::chrono::steady_clock::now() + std::chrono::milliseconds(worker.backoffMs);
+    worker.backoffMs = std::min(worker.backoffMs * 2, TTT::modelRestartMaxMs);
+
+    // Anything still queued would only wait on the restart, so fail it now
+    std::deque<Message> dropped;
+    {
+        const std::lock_guard<std::mutex> lock(worker.lock);
+        dropped.swap(worker.messages);
+    }
+    for (Message& message : dropped) {
+        if (message.wantsReply) {
+            {
+                const std::lock_guard<std::mutex> lock(worker.lock);
+                worker.stats.requests++;
+                worker.stats.failures++;
+            }
+            worker.depth--;
+            message.reply.set_value(-1);
+        }
+    }
+}
+
+int ModelPool::ask(Worker& worker, const std::string& line) {
+    if (!worker.process.writeLine(line)) {
+        return -1;
+    }
+
+    // Skip the model's debug output until we get the move
+    std::string reply;
+    if (!readUntil(worker, "RSPMV", TTT::modelReplyTimeoutMs, reply)) {
+        return -1;
+    }
+    return atoi(reply.c_str() + reply.find("RSPMV") + 6);
+}
+
+int ModelPool::askBatch(Worker& worker, const std::string& line, std::vector<int>& moves) {
+    if (!worker.process.writeLine(line)) {
+        return -1;
+    }
+    std::string reply;
+    if (!readUntil(worker, "RSPBATCH", TTT::modelReplyTimeoutMs, reply)) {
+        return -1;
+    }
+
+    // RSPBATCH m1,m2,...
+    moves.clear();
+    const char* cursor = reply.c_str() + reply.find("RSPBATCH") + 8;
+    while (*cursor) {
+        char* end = nullptr;
+        const long move = std::strtol(cursor, &end, 10);
+        if (end == cursor) {
+            break;
+        }
+        moves.push_back(static_cast<int>(move));
+        cursor = *end == ',' ? end + 1 : end;
+    }
+    return static_cast<int>(moves.size());
+}
+
+bool ModelPool::ping(Worker& worker) {
+    const auto start = std::chrono::steady_clock::now();
+    std::string line;
+    if (!worker.process.writeLine("PING") || !readUntil(worker, "PONG", TTT::modelHeartbeatTimeoutMs, line)) {
+        return false;
+    }
+    const double roundTrip = millisecondsSince(start);
+    const std::lock_guard<std::mutex> lock(worker.lock);
+    worker.stats.pings++;
+    worker.stats.lastPingMs = roundTrip;
+    worker.stats.maxPingMs = std::max(worker.stats.maxPingMs, roundTrip);
+    return true;
+}
+
+void ModelPool::workerLoop(Worker& worker) {
+    // The first worker trains or loads the checkpoint (and saves it) before the others start
+    if (worker.index > 0) {
+        std::unique_lock<std::mutex> lock(readyLock);
+        readyChanged.wait(lock, [this] {return firstStartDone || stopping;});
+    }
+
+    while (true) {
+        // Start the model, or restart it once its backoff has passed
+        if (!worker.ready && !stopping && std::chrono::steady_clock::now() >= worker.nextStart) {
+            if (!startProcess(worker)) {
+                stopProcess(worker, "START_FAILED");
+            }
+            if (worker.index == 0) {
+                {
+                    const std::lock_guard<std::mutex> lock(readyLock);
+                    firstStartDone = true;
+                }
+                readyChanged.notify_all();
+            }
+        }
+
+        Message message;
+        {
+            // A ready model wakes up for its next heartbeat, a model that's down for its restart
+            std::unique_lock<std::mutex> lock(worker.lock);
+            const auto wakeAt = worker.ready ? worker.lastHeard + std::chrono::milliseconds(TTT::modelHeartbeatIntervalMs) : worker.nextStart;
+            worker.wake.wait_until(lock, wakeAt, [&] {return stopping || !worker.messages.empty();});
+            if (worker.messages.empty()) {
+                if (stopping) {
+                    break;
+                }
+                lock.unlock();
+                if (worker.ready && std::chrono::steady_clock::now() >= wakeAt && !ping(worker)) {
+                    stopProcess(worker, "MISSED_HEARTBEAT");
+                }
+                continue;
+            }
+            message = std::move(worker.messages.front());
+            worker.messages.pop_front();
+        }
+
+        if (!message.wantsReply) {
+            // Pass it on and print anything the model has said since
+            if (worker.ready) {
+                if (!worker.process.writeLine(message.line)) {
+                    stopProcess(worker, "WRITE_FAILED");
+                }
+                std::string line;
+                while (worker.ready && worker.process.readLine(line, 1)) {
+                    worker.lastHeard = std::chrono::steady_clock::now();
+                    if (echo) {
+                        std::cout << "[MODEL " << worker.index << "] " << line << std::endl;
+                    }
+                }
+            }
+            continue;
+        }
+
+        int move = -1;
+        if (worker.ready) {
+            move = message.moves ? askBatch(worker, message.line, *message.moves) : ask(worker, message.line);
+            if (move < 0) {
+                stopProcess(worker, "NO_RESPONSE");
+            } else {
+                worker.backoffMs = TTT::modelRestartMinMs; // It's healthy again
+            }
+        }
+
+        const double latency = millisecondsSince(message.queued);
+        {
+            const std::lock_guard<std::mutex> lock(worker.lock);
+            worker.stats.requests++;
+            worker.stats.failures += move < 0 ? 1 : 0;
+            worker.stats.totalLatencyMs += latency;
+            worker.stats.maxLatencyMs = std::max(worker.stats.maxLatencyMs, latency);
+        }
+        worker.depth--;
+        message.reply.set_value(move);
+    }
+
+    // Let the model save and exit. No line contains "\n", so this prints everything it says
+    // until it closes its output. A model that's still starting up is just killed, and so is one
+    // that hasn't closed its output by the deadline, so a hung model can't stall closing the game.
+    if (worker.ready) {
+        worker.process.writeLine("shutdown");
+        std::string line;
+        const auto asked = std::chrono::steady_clock::now();
+        readUntil(worker, "\n", TTT::modelReplyTimeoutMs, line);
+        if (millisecondsSince(asked) >= TTT::modelReplyTimeoutMs && worker.process.isRunning()) {
+            std::cerr << "ERROR::MODEL_POOL::SHUTDOWN_TIMED_OUT, killing model worker " << worker.index << std::endl;
+            worker.process.kill();
+        }
+    } else {
+        worker.process.kill();
+    }
+    worker.ready = false;
+    const int code = worker.process.close();
+    if (echo && worker.started) {
+        std::cout << "Model worker " << worker.index << " exited with code " << code << std::endl;
+    }
+}
+
+std::future<int> ModelPool::requestMove(const std::string& features, const int attempts) {
+    Message message;
+    message.line = "RQSTMV[" + features + "]&" + std::to_string(attempts);
+    return send(std::move(message));
+}
+
+std::future<int> ModelPool::requestBatch(const std::vector<std::string>& rows, std::vector<int>& moves) {
+    moves.clear();
+    if (rows.empty()) {
+        std::promise<int> nothing;
+        nothing.set_value(0);
+        return nothing.get_future();
+    }
+    Message message;
+    message.line = "RQSTBATCH[";
+    for (size_t i = 0; i < rows.size(); i++) {
+        message.line += (i > 0 ? ";" : "") + rows[i];
+    }
+    message.line += "]";
+    message.moves = &moves;
+    return send(std::move(message));
+}
+
+std::future<int> ModelPool::send(Message message) {
+    message.wantsReply = true;
+    message.queued = std::chrono::steady_clock::now();
+    std::future<int> reply = message.reply.get_future();
+
+    // The least busy ready worker. Ties are broken by starting the search at a different worker each time.
+    Worker* target = nullptr;
+    const size_t first = nextWorker++;
+    for (size_t i = 0; i < workers.size(); i++) {
+        Worker* worker = workers[(first + i) % workers.size()].get();
+        if (worker->ready && (!target || worker->depth < target->depth)) {
+            target = worker;
+        }
+    }
+    if (!target) {
+        // Every model is down (or still starting), so don't make the caller wait
+        message.reply.set_value(-1);
+        return reply;
+    }
+
+    target->depth++;
+    {
+        const std::lock_guard<std::mutex> lock(target->lock);
+        target->messages.push_back(std::move(message));
+    }
+    target->wake.notify_one();
+    return reply;
+}
+
+void ModelPool::broadcast(const std::string& line) {
+    for (auto& worker : workers) {
+        if (!worker->ready) {
+            continue;
+        }
+        Message message;
+        message.line = line;
+        message.queued = std::chrono::steady_clock::now();
+        {
+            const std::lock_guard<std::mutex> lock(worker->lock);
+            worker->messages.push_back(std::move(message));
+        }
+        worker->wake.notify_one();
+    }
+}
+
+bool ModelPool::isReady() const {
+    return std::any_of(workers.begin(), workers.end(), [](const auto& worker) {return worker->ready.load();});
+}
+
+bool ModelPool::waitUntilReady(const int timeoutMs) {
+    std::unique_lock<std::mutex> lock(readyLock);
+    readyChanged.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {return isReady() || stopping;});
+    return isReady();
+}
+
+std::vector<ModelPool::WorkerStats> ModelPool::stats() const {
+    std::vector<WorkerStats> result;
+    for (const auto& worker : workers) {
+        const std::lock_guard<std::mutex> lock(worker->lock);
+        WorkerStats stats = worker->stats;
+        stats.depth = worker->depth;
+        stats.ready = worker->ready;
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void ModelPool::printStats(std::ostream& out) const {
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - created).count();
+    const std::vector<WorkerStats> all = stats();
+    for (size_t i = 0; i < all.size(); i++) {
+        const WorkerStats& stats = all[i];
+        out << "Model worker " << i << ": " << stats.requests << " requests ("
+            << stats.requests / std::max(seconds, 1e-9) << "/s), latency mean "
+            << (stats.requests > 0 ? stats.totalLatencyMs / stats.requests : 0.0) << " ms, max " << stats.maxLatencyMs
+            << " ms, heartbeat last " << stats.lastPingMs << " ms, max " << stats.maxPingMs << " ms ("
+            << stats.pings << " pings), " << stats.failures << " failed, " << stats.restarts << " restarts"
+            << (stats.ready ? "" : " (not ready)") << std::endl;
+    }
+}
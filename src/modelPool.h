@@ -0,0 +1,142 @@
+#ifndef MODEL_POOL_H
+#define MODEL_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "modelProcess.h"
+
+class ModelPool {
+    // Several copies of our Python model, each in its own subprocess, answering move requests
+    // in parallel. Every worker has a thread that owns its subprocess and a queue of messages,
+    // and each request goes to the ready worker with the fewest requests waiting or in progress.
+    // The first worker starts on its own so it trains (or loads the checkpoint) and saves the
+    // checkpoint; the rest start after it and just load that checkpoint.
+    //
+    // Every worker also supervises its model. An idle model is pinged (PING/PONG) every
+    // TTT::modelHeartbeatIntervalMs. A model that crashes, misses a heartbeat or takes longer than
+    // TTT::modelReplyTimeoutMs to answer is killed and restarted after a delay that doubles with every
+    // failure in a row, from TTT::modelRestartMinMs up to TTT::modelRestartMaxMs. Nothing ever waits on
+    // a model that's down: its requests resolve to -1 straight away so the caller can fall back.
+    public:
+        // Counters for one worker. Latency is from a request being queued to its reply.
+        struct WorkerStats {
+            size_t requests = 0;
+            size_t failures = 0;
+            size_t restarts = 0;
+            double totalLatencyMs = 0.0;
+            double maxLatencyMs = 0.0;
+            size_t pings = 0;
+            double lastPingMs = 0.0;
+            double maxPingMs = 0.0;
+            int depth = 0;
+            bool ready = false;
+        };
+
+        // Starts every worker in the background. With echo on, everything the models print is printed too.
+        ModelPool(const int workers, const std::string& command, const bool echo = false);
+        ~ModelPool();
+
+        ModelPool(const ModelPool&) = delete;
+        ModelPool& operator=(const ModelPool&) = delete;
+
+        // Ask for a move. features is a row formatted by Features::formatRow with a move of -1,
+        // attempts is how many times we've asked about this board already (the model guesses after 10).
+        // Resolves to the suggested cell, or -1 if no model could answer.
+        std::future<int> requestMove(const std::string& features, const int attempts);
+
+        // Ask for a move for every row at once, in a single RQSTBATCH message that the model answers
+        // with one predict call. Rows are formatted like requestMove's features. The moves (the model's
+        // first choice, which may be illegal) are written to moves, which has to stay alive until the
+        // future resolves. Resolves to the number of moves, or -1 if no model could answer.
+        std::future<int> requestBatch(const std::vector<std::string>& rows, std::vector<int>& moves);
+
+        // Send a line to every model that's up without waiting for a reply (e.g. TRAIN rows)
+        void broadcast(const std::string& line);
+
+        // Check if any worker is ready to answer
+        bool isReady() const;
+
+        // Block until a worker is ready or timeoutMs has passed. Returns isReady().
+        bool waitUntilReady(const int timeoutMs);
+
+        int size() const {return static_cast<int>(workers.size());}
+
+        std::vector<WorkerStats> stats() const;
+
+        // One line per worker: requests, throughput, latency, heartbeat round trips, failures and restarts
+        void printStats(std::ostream& out) const;
+
+    private:
+        struct Message {
+            std::string line;
+            bool wantsReply = false; // Requests want a move back, broadcasts don't
+            std::vector<int>* moves = nullptr; // Where a batch's moves go
+            std::promise<int> reply;
+            std::chrono::steady_clock::time_point queued;
+        };
+
+        struct Worker {
+            int index = 0;
+            ModelProcess process;
+            std::thread thread;
+            std::mutex lock; // Guards messages and stats
+            std::condition_variable wake;
+            std::deque<Message> messages;
+            WorkerStats stats;
+            std::atomic<int> depth = 0; // Requests queued or in progress
+            std::atomic<bool> ready = false;
+
+            // Only touched by the worker's own thread
+            bool started = false;
+            int backoffMs = 0;
+            std::chrono::steady_clock::time_point nextStart;
+            std::chrono::steady_clock::time_point lastHeard; // When the model last said anything
+        };
+
+        // Launch a worker's subprocess and wait until it's ready
+        bool startProcess(Worker& worker);
+
+        // Kill a worker's model, fail everything it was asked, and schedule a restart
+        void stopProcess(Worker& worker, const std::string& reason);
+
+        // Read lines until one contains marker. Returns false if the model didn't say it in time.
+        bool readUntil(Worker& worker, const std::string& marker, const int timeoutMs, std::string& line);
+
+        // Send a request line and wait for the model's move. Returns -1 if it didn't answer.
+        int ask(Worker& worker, const std::string& line);
+
+        // Send a batch and wait for all its moves. Returns how many there were, or -1 if it didn't answer.
+        int askBatch(Worker& worker, const std::string& line, std::vector<int>& moves);
+
+        // Queue a request on the least busy ready worker, or resolve it to -1 if none are ready
+        std::future<int> send(Message message);
+
+        // Heartbeat. Returns false if the model didn't answer.
+        bool ping(Worker& worker);
+
+        void workerLoop(Worker& worker);
+
+        std::string command;
+        bool echo;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::chrono::steady_clock::time_point created;
+        std::atomic<size_t> nextWorker = 0;
+        std::atomic<bool> stopping = false;
+
+        // Signalled when a worker becomes ready, and once the first worker has had its first go at starting
+        std::mutex readyLock;
+        std::condition_variable readyChanged;
+        bool firstStartDone = false;
+};
+
+#endif
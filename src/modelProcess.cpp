@@ -0,0 +1,372 @@
+#include <chrono>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <mutex>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "modelProcess.h"
+
+ModelProcess::~ModelProcess() {
+    close();
+}
+
+std::string ModelProcess::readAvailable() {
+    fill(0);
+    std::string result;
+    result.swap(pending);
+    return result;
+}
+
+bool ModelProcess::readLine(std::string& line, const int timeoutMs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        // Hand back a line if we already have a whole one
+        const size_t newline = pending.find('\n');
+        if (newline != std::string::npos) {
+            line = pending.substr(0, newline);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back(); // Windows line endings
+            }
+            pending.erase(0, newline + 1);
+            return true;
+        }
+
+        // Otherwise wait for more output
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0 || !fill(static_cast<int>(remaining))) {
+            return false;
+        }
+    }
+}
+
+#ifdef _WIN32
+bool ModelProcess::start(const std::string& command) {
+    if (started) {
+        return false;
+    }
+
+    // see https://learn.microsoft.com/en-us/windows/win32/procthread/creating-a-child-process-with-redirected-input-and-output
+    HANDLE stdinRead = NULL;
+    HANDLE stdoutWrite = NULL;
+    SECURITY_ATTRIBUTES sas;
+    sas.nLength = sizeof(SECURITY_ATTRIBUTES);
+    sas.bInheritHandle = TRUE; // Allow inherited pipe handles
+    sas.lpSecurityDescriptor = NULL;
+
+    // Create pipes (see https://learn.microsoft.com/en-us/windows/win32/api/namedpipeapi/nf-namedpipeapi-createpipe)
+    if (!CreatePipe(&stdoutRead, &stdoutWrite, &sas, 0)) {
+        std::cerr << "ERROR::MODEL_PROCESS::PIPE_STDOUT " << GetLastError() << std::endl;
+        return false;
+    }
+    // Only the child inherits its ends of the pipes
+    SetHandleInformation(stdoutRead, HANDLE_FLAG_INHERIT, 0);
+
+    if (!CreatePipe(&stdinRead, &stdinWrite, &sas, 0)) {
+        std::cerr << "ERROR::MODEL_PROCESS::PIPE_STDIN " << GetLastError() << std::endl;
+        CloseHandle(stdoutRead);
+        CloseHandle(stdoutWrite);
+        stdoutRead = nullptr;
+        return false;
+    }
+    SetHandleInformation(stdinWrite, HANDLE_FLAG_INHERIT, 0);
+
+    // Create the child process (see https://learn.microsoft.com/en-us/windows/win32/procthread/creating-processes)
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.hStdError = stdoutWrite;
+    si.hStdOutput = stdoutWrite;
+    si.hStdInput = stdinRead;
+    si.dwFlags |= STARTF_USESTDHANDLES;
+    ZeroMemory(&pi, sizeof(pi));
+
+    std::string commandLine = command; // CreateProcess may modify the command line
+    const BOOL success = CreateProcessA(NULL, commandLine.data(), NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi);
+
+    // Close the child's ends, the child has its own copies now
+    CloseHandle(stdoutWrite);
+    CloseHandle(stdinRead);
+    if (!success) {
+        std::cerr << "ERROR::MODEL_PROCESS::SPAWN_FAILED " << GetLastError() << std::endl;
+        CloseHandle(stdoutRead);
+        CloseHandle(stdinWrite);
+        stdoutRead = nullptr;
+        stdinWrite = nullptr;
+        return false;
+    }
+
+    process = pi.hProcess;
+    thread = pi.hThread;
+    started = true;
+    exited = false;
+    exitCode = -1;
+    return true;
+}
+
+bool ModelProcess::writeLine(const std::string& line) {
+    if (!stdinWrite) {
+        return false;
+    }
+
+    // See https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-writefile
+    const std::string msg = line + "\n";
+    DWORD bytesWritten = 0;
+    return WriteFile(stdinWrite, msg.c_str(), static_cast<DWORD>(msg.size()), &bytesWritten, NULL) && bytesWritten == msg.size();
+}
+
+bool ModelProcess::fill(const int timeoutMs) {
+    if (!stdoutRead) {
+        return false;
+    }
+
+    // Anonymous pipes can't be waited on, so peek until there's something to read
+    // See https://learn.microsoft.com/en-us/windows/win32/api/namedpipeapi/nf-namedpipeapi-peeknamedpipe
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    DWORD bytesToRead = 0;
+    while (true) {
+        if (!PeekNamedPipe(stdoutRead, NULL, 0, NULL, &bytesToRead, NULL)) {
+            return false; // The process closed its end
+        }
+        if (bytesToRead > 0 || std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        Sleep(1);
+    }
+    if (bytesToRead == 0) {
+        return true;
+    }
+
+    char buf[4096];
+    DWORD bytesRead = 0;
+    if (!ReadFile(stdoutRead, buf, sizeof(buf), &bytesRead, NULL)) {
+        return false;
+    }
+    pending.append(buf, bytesRead);
+    return true;
+}
+
+bool ModelProcess::isRunning() {
+    if (!started || exited) {
+        return false;
+    }
+    if (WaitForSingleObject(process, 0) == WAIT_TIMEOUT) {
+        return true;
+    }
+    DWORD code = 0;
+    GetExitCodeProcess(process, &code);
+    exitCode = static_cast<int>(code);
+    exited = true;
+    return false;
+}
+
+void ModelProcess::kill() {
+    if (started && !exited) {
+        TerminateProcess(process, 1);
+    }
+}
+
+int ModelProcess::close() {
+    if (!started) {
+        return -1;
+    }
+
+    // Closing stdin lets the child see the end of its input
+    if (stdinWrite) {
+        CloseHandle(stdinWrite);
+        stdinWrite = nullptr;
+    }
+    if (!exited) {
+        WaitForSingleObject(process, INFINITE);
+        DWORD code = 0;
+        GetExitCodeProcess(process, &code);
+        exitCode = static_cast<int>(code);
+        exited = true;
+    }
+    if (stdoutRead) {
+        CloseHandle(stdoutRead);
+        stdoutRead = nullptr;
+    }
+    CloseHandle(process);
+    CloseHandle(thread);
+    process = nullptr;
+    thread = nullptr;
+    pending.clear();
+    started = false;
+    return exitCode;
+}
+
+#else
+namespace {
+#ifndef __linux__
+    // Without pipe2, a pipe is only close-on-exec once fcntl has been called on it. Other threads
+    // starting models of their own mustn't fork in between, or their child inherits our pipe.
+    std::mutex spawnMutex;
+#endif
+
+    // A pipe whose ends are closed in any child that execs, so other children we spawn never inherit them
+    bool openPipe(int fds[2]) {
+#ifdef __linux__
+        return pipe2(fds, O_CLOEXEC) == 0;
+#else
+        if (pipe(fds) != 0) {
+            return false;
+        }
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return true;
+#endif
+    }
+}
+
+bool ModelProcess::start(const std::string& command) {
+    if (started) {
+        return false;
+    }
+
+    // A child that dies while we're writing to it would otherwise kill us with SIGPIPE.
+    // We'd rather see the write fail.
+    std::signal(SIGPIPE, SIG_IGN);
+
+#ifndef __linux__
+    // Held from creating the pipes until we've forked (see spawnMutex)
+    const std::lock_guard<std::mutex> lock(spawnMutex);
+#endif
+
+    // [0] is the read end, [1] the write end
+    int inPipe[2];
+    int outPipe[2];
+    if (!openPipe(inPipe)) {
+        std::cerr << "ERROR::MODEL_PROCESS::PIPE_STDIN" << std::endl;
+        return false;
+    }
+    if (!openPipe(outPipe)) {
+        std::cerr << "ERROR::MODEL_PROCESS::PIPE_STDOUT" << std::endl;
+        ::close(inPipe[0]);
+        ::close(inPipe[1]);
+        return false;
+    }
+
+    // exec replaces the shell, so the pid we get is the command's own (and kill() reaches it).
+    // Built before forking, since only a few calls are safe in the child of a threaded program.
+    const std::string shellCommand = "exec " + command;
+
+    pid = fork();
+    if (pid < 0) {
+        std::cerr << "ERROR::MODEL_PROCESS::SPAWN_FAILED" << std::endl;
+        for (int fd : {inPipe[0], inPipe[1], outPipe[0], outPipe[1]}) {
+            ::close(fd);
+        }
+        return false;
+    }
+
+    if (pid == 0) {
+        // Child: connect the pipes to stdin/stdout/stderr (dup2 clears close-on-exec) and run the command
+        dup2(inPipe[0], STDIN_FILENO);
+        dup2(outPipe[1], STDOUT_FILENO);
+        dup2(outPipe[1], STDERR_FILENO);
+        execl("/bin/sh", "sh", "-c", shellCommand.c_str(), static_cast<char*>(nullptr));
+        _exit(127); // Only reached if exec failed
+    }
+
+    // Parent: close the child's ends
+    ::close(inPipe[0]);
+    ::close(outPipe[1]);
+    stdinWrite = inPipe[1];
+    stdoutRead = outPipe[0];
+    started = true;
+    exited = false;
+    exitCode = -1;
+    return true;
+}
+
+bool ModelProcess::writeLine(const std::string& line) {
+    if (stdinWrite < 0) {
+        return false;
+    }
+
+    const std::string msg = line + "\n";
+    size_t written = 0;
+    while (written < msg.size()) {
+        const ssize_t result = write(stdinWrite, msg.c_str() + written, msg.size() - written);
+        if (result < 0) {
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+bool ModelProcess::fill(const int timeoutMs) {
+    if (stdoutRead < 0) {
+        return false;
+    }
+
+    pollfd pfd = {stdoutRead, POLLIN, 0};
+    const int ready = poll(&pfd, 1, timeoutMs);
+    if (ready <= 0) {
+        return ready == 0; // Timed out, but the pipe is still open
+    }
+
+    char buf[4096];
+    const ssize_t bytesRead = read(stdoutRead, buf, sizeof(buf));
+    if (bytesRead <= 0) {
+        return false; // The process closed its end
+    }
+    pending.append(buf, static_cast<size_t>(bytesRead));
+    return true;
+}
+
+bool ModelProcess::isRunning() {
+    if (!started || exited) {
+        return false;
+    }
+    int status = 0;
+    if (waitpid(pid, &status, WNOHANG) == 0) {
+        return true;
+    }
+    exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    exited = true;
+    return false;
+}
+
+void ModelProcess::kill() {
+    if (started && !exited) {
+        ::kill(pid, SIGKILL);
+    }
+}
+
+int ModelProcess::close() {
+    if (!started) {
+        return -1;
+    }
+
+    // Closing stdin lets the child see the end of its input
+    if (stdinWrite >= 0) {
+        ::close(stdinWrite);
+        stdinWrite = -1;
+    }
+    if (!exited) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        exited = true;
+    }
+    if (stdoutRead >= 0) {
+        ::close(stdoutRead);
+        stdoutRead = -1;
+    }
+    pid = -1;
+    pending.clear();
+    started = false;
+    return exitCode;
+}
+#endif
@@ -0,0 +1,65 @@
+#ifndef MODEL_PROCESS_H
+#define MODEL_PROCESS_H
+
+#include <string>
+
+class ModelProcess {
+    // A child process (e.g. our Python model) that we talk to one line at a time
+    // through its stdin and stdout. stderr is sent to stdout as well.
+    // Uses pipes and CreateProcess on Windows, pipes and fork/exec everywhere else.
+    public:
+        ModelProcess() = default;
+        ~ModelProcess();
+
+        // Owns the pipes, so it can't be copied
+        ModelProcess(const ModelProcess&) = delete;
+        ModelProcess& operator=(const ModelProcess&) = delete;
+
+        // Launch a command line. Returns false if the process couldn't be started.
+        bool start(const std::string& command);
+
+        // Send one line (a newline is added)
+        bool writeLine(const std::string& line);
+
+        // Return whatever output is waiting without blocking (may be empty)
+        std::string readAvailable();
+
+        // Wait up to timeoutMs for a full line of output (without the newline).
+        // Returns false on timeout or if the process has exited.
+        bool readLine(std::string& line, const int timeoutMs);
+
+        // Check if the process was started and hasn't exited yet
+        bool isRunning();
+
+        // Close our end of the pipes and wait for the process to exit. Returns its exit code,
+        // or -1 if it was never started.
+        int close();
+
+        // Stop a process that isn't responding. close() still has to be called afterwards.
+        void kill();
+
+    private:
+        // Read once from the pipe into pending. Waits at most timeoutMs for data.
+        // Returns false if the pipe was closed.
+        bool fill(const int timeoutMs);
+
+        // Output that has been read but not returned yet
+        std::string pending;
+        bool started = false;
+        bool exited = false;
+        int exitCode = -1;
+
+#ifdef _WIN32
+        // HANDLEs, kept as void* so this header doesn't need windows.h
+        void* stdinWrite = nullptr;
+        void* stdoutRead = nullptr;
+        void* process = nullptr;
+        void* thread = nullptr;
+#else
+        int stdinWrite = -1;
+        int stdoutRead = -1;
+        int pid = -1;
+#endif
+};
+
+#endif
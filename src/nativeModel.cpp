@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory_resource>
+#include <sstream>
+
+#include "nativeModel.h"
+#include "arena.h"
+
+bool NativeModel::load(const std::string& path) {
+    layers.clear();
+    classes.clear();
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "ERROR::NATIVE_MODEL::CANNOT_OPEN " << path << std::endl;
+        return false;
+    }
+
+    std::string magic;
+    int version = 0;
+    std::string hiddenName;
+    std::string outputName;
+    file >> magic >> version >> hiddenName >> outputName;
+    if (magic != "TTTMLP" || version != 1) {
+        std::cerr << "ERROR::NATIVE_MODEL::NOT_A_MODEL " << path << std::endl;
+        return false;
+    }
+    const std::array<std::string, 4> names = {"identity", "logistic", "tanh", "relu"};
+    const auto found = std::find(names.begin(), names.end(), hiddenName);
+    if (found == names.end() || (outputName != "softmax" && outputName != "logistic")) {
+        std::cerr << "ERROR::NATIVE_MODEL::UNKNOWN_ACTIVATION " << hiddenName << " / " << outputName << std::endl;
+        return false;
+    }
+    hidden = static_cast<Activation>(found - names.begin());
+
+    // The classes are one line, since there can be any number of them
+    std::string line;
+    std::getline(file >> std::ws, line);
+    std::istringstream classLine(line);
+    for (int value; classLine >> value;) {
+        classes.push_back(value);
+    }
+
+    std::vector<Layer> loaded;
+    int count = 0;
+    file >> count;
+    for (int i = 0; i < count && file; i++) {
+        Layer layer;
+        file >> layer.inputs >> layer.outputs;
+        if (!file || layer.inputs <= 0 || layer.outputs <= 0 || (!loaded.empty() && layer.inputs != loaded.back().outputs)) {
+            break;
+        }
+        layer.weights.resize(static_cast<size_t>(layer.inputs) * layer.outputs);
+        layer.biases.resize(layer.outputs);
+        for (double& weight : layer.weights) file >> weight;
+        for (double& bias : layer.biases) file >> bias;
+        loaded.push_back(std::move(layer));
+    }
+
+    // Two classes have one output (the probability of the second), any more have one output each
+    const int outputs = loaded.empty() ? 0 : loaded.back().outputs;
+    const bool fits = classes.size() == 2 ? outputs == 1 : outputs == static_cast<int>(classes.size());
+    if (!file || count <= 0 || static_cast<int>(loaded.size()) != count || classes.empty() || !fits) {
+        std::cerr << "ERROR::NATIVE_MODEL::MALFORMED " << path << std::endl;
+        classes.clear();
+        return false;
+    }
+    layers = std::move(loaded);
+    return true;
+}
+
+int NativeModel::predict(const std::span<const int> features) const {
+    if (!isLoaded() || static_cast<int>(features.size()) != layers.front().inputs) {
+        return -1;
+    }
+
+    // Ping-pong between two buffers from this thread's arena, one layer at a time
+    Arena::Scope scratch;
+    std::pmr::vector<double> values(features.begin(), features.end(), scratch.resource());
+    std::pmr::vector<double> next(scratch.resource());
+    for (size_t l = 0; l < layers.size(); l++) {
+        const Layer& layer = layers[l];
+        next.assign(layer.biases.begin(), layer.biases.end());
+        for (int i = 0; i < layer.inputs; i++) {
+            const double input = values[i];
+            const double* row = &layer.weights[static_cast<size_t>(i) * layer.outputs];
+            for (int o = 0; o < layer.outputs; o++) {
+                next[o] += input * row[o];
+            }
+        }
+
+        // The output layer's activation (softmax or logistic) doesn't change which output is biggest
+        if (l + 1 < layers.size()) {
+            for (double& value : next) {
+                switch (hidden) {
+                    case LOGISTIC:
+                        value = 1.0 / (1.0 + std::exp(-value));
+                        break;
+                    case TANH:
+                        value = std::tanh(value);
+                        break;
+                    case RELU:
+                        value = std::max(value, 0.0);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+        std::swap(values, next);
+    }
+
+    if (classes.size() == 2) {
+        return classes[values[0] > 0.0 ? 1 : 0];
+    }
+    return classes[std::max_element(values.begin(), values.end()) - values.begin()];
+}
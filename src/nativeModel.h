@@ -0,0 +1,51 @@
+#ifndef NATIVE_MODEL_H
+#define NATIVE_MODEL_H
+
+#include <span>
+#include <string>
+#include <vector>
+
+class NativeModel {
+    // The MLP model.py trains, run in this process instead of in Python. model.py writes the weights
+    // as text (<log>_weights.txt, next to its checkpoint) every time it saves the checkpoint:
+    //   TTTMLP 1
+    //   <hidden activation: identity, logistic, tanh or relu>
+    //   <output activation: softmax, or logistic with a single output for two classes>
+    //   <the class (move) of every output, in order>
+    //   <number of layers>
+    //   then for every layer: "<inputs> <outputs>", its weights row by row (inputs x outputs), its biases
+    // A prediction is the same forward pass sklearn does, in doubles, so it picks the same move as
+    // model.predict for the same features.
+    public:
+        // Read the weights. Returns false (and prints why) if the file is missing or malformed.
+        bool load(const std::string& path);
+
+        bool isLoaded() const {return !layers.empty();}
+
+        // The predicted class (move) for a row of features, or -1 if nothing is loaded or
+        // the features don't fit the model
+        int predict(const std::span<const int> features) const;
+
+        const std::vector<int>& getClasses() const {return classes;}
+
+    private:
+        enum Activation {
+            IDENTITY = 0,
+            LOGISTIC = 1,
+            TANH = 2,
+            RELU = 3
+        };
+
+        struct Layer {
+            int inputs = 0;
+            int outputs = 0;
+            std::vector<double> weights; // inputs x outputs, row by row
+            std::vector<double> biases;
+        };
+
+        std::vector<Layer> layers;
+        std::vector<int> classes;
+        Activation hidden = RELU;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "policy.h"
+#include "arena.h"
+#include "boardFeatures.h"
+#include "constants.h"
+#include "symmetry.h"
+
+namespace {
+    // Negamax over every position reachable from this one, filling in the table as we go.
+    // Symmetric positions have the same score, so only canonical positions are stored.
+    int solve(const GameState& game, std::unordered_map<std::uint32_t, signed char>& table) {
+        const std::uint32_t key = Symmetry::canonicalize(game).key;
+        const auto iter = table.find(key);
+        if (iter != table.end()) {
+            return iter->second;
+        }
+
+        // The earlier a game ends, the more empty cells it has, so faster wins score higher
+        const int empty = GameState::cells - game.getMoveCount();
+        int best = 0;
+        switch (game.getStatus()) {
+            case GameState::X_WIN:
+            case GameState::C_WIN:
+                best = -(1 + empty); // Whoever just moved won, so the player to move has lost
+                break;
+            case GameState::DRAW:
+                best = 0;
+                break;
+            default:
+                best = -100;
+                for (int cell = 0; cell < 9; cell++) {
+                    GameState next = game;
+                    if (next.playMove(cell)) {
+                        best = std::max(best, -solve(next, table));
+                    }
+                }
+        }
+        table.emplace(key, static_cast<signed char>(best));
+        return best;
+    }
+}
+
+int RandomPolicy::chooseMove(const GameState& game, std::mt19937& rng) {
+    Arena::Scope scratch;
+    std::pmr::vector<int> moves(scratch.resource());
+    for (int cell = 0; cell < 9; cell++) {
+        if (game.canPlace(cell)) moves.push_back(cell);
+    }
+    if (moves.empty() || game.isOver()) {
+        return -1;
+    }
+    return moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(rng)];
+}
+
+const std::unordered_map<std::uint32_t, signed char>& PerfectPolicy::table() {
+    // Statics are initialized once, even with many threads
+    static const std::unordered_map<std::uint32_t, signed char> scores = [] {
+        std::unordered_map<std::uint32_t, signed char> result;
+        solve(GameState(), result);
+        return result;
+    }();
+    return scores;
+}
+
+int PerfectPolicy::score(const GameState& game) {
+    return table().at(Symmetry::canonicalize(game).key);
+}
+
+int PerfectPolicy::chooseMove(const GameState& game, std::mt19937& rng) {
+    if (game.isOver()) {
+        return -1;
+    }
+
+    // Gather every move that's as good as the best one
+    Arena::Scope scratch;
+    std::pmr::vector<int> best(scratch.resource());
+    int bestScore = -100;
+    for (int cell = 0; cell < 9; cell++) {
+        GameState next = game;
+        if (!next.playMove(cell)) {
+            continue;
+        }
+        const int moveScore = -score(next);
+        if (moveScore > bestScore) {
+            bestScore = moveScore;
+            best.clear();
+        }
+        if (moveScore == bestScore) {
+            best.push_back(cell);
+        }
+    }
+    if (best.empty()) {
+        return -1;
+    }
+    return best[std::uniform_int_distribution<size_t>(0, best.size() - 1)(rng)];
+}
+
+int EpsilonGreedyPolicy::chooseMove(const GameState& game, std::mt19937& rng) {
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < epsilon) {
+        return random.chooseMove(game, rng);
+    }
+    return perfect.chooseMove(game, rng);
+}
+
+ModelPolicy::ModelPolicy(std::shared_ptr<ModelPool> pool) : pool(std::move(pool)) {
+    if (!this->pool) {
+        this->pool = std::make_shared<ModelPool>(1, TTT::modelCommand);
+        if (!this->pool->waitUntilReady(TTT::modelStartTimeoutMs)) {
+            std::cerr << "ERROR::MODEL_POLICY::NOT_READY" << std::endl;
+        }
+    }
+}
+
+int ModelPolicy::chooseMove(const GameState& game, std::mt19937& rng) {
+    if (game.isOver()) {
+        return -1;
+    }
+    if (!isReady()) {
+        return fallback.chooseMove(game, rng);
+    }
+
+    // Same request the game sends: the features with an invalid move, then the attempt number.
+    // The model picks randomly itself after enough attempts, but that can still be an illegal move.
+    Arena::Scope scratch;
+    const std::string features = Features::formatRow(Features::extract(game.getGrid(), scratch.resource()), -1);
+    for (int attempts = 0; attempts <= TTT::modelMaxAttempts; attempts++) {
+        const int move = pool->requestMove(features, attempts).get();
+        if (move < 0) {
+            // The model is down (or just stopped answering) and is being restarted
+            return fallback.chooseMove(game, rng);
+        }
+        if (game.canPlace(move)) {
+            return move;
+        }
+        if (attempts == 0) {
+            illegal++;
+        }
+    }
+
+    // Out of attempts
+    return random.chooseMove(game, rng);
+}
+
+NativeModelPolicy::NativeModelPolicy(const std::string& path) {
+    if (!model.load(path)) {
+        std::cerr << "ERROR::NATIVE_MODEL_POLICY::NOT_LOADED, the perfect policy will play instead" << std::endl;
+    }
+}
+
+int NativeModelPolicy::chooseMove(const GameState& game, std::mt19937& rng) {
+    if (game.isOver()) {
+        return -1;
+    }
+    if (!isLoaded()) {
+        return fallback.chooseMove(game, rng);
+    }
+
+    const std::uint32_t key = Symmetry::key(game.getBits(GameState::X), game.getBits(GameState::CIRCLE));
+    auto found = features.find(key);
+    if (found == features.end()) {
+        Arena::Scope scratch;
+        const auto extracted = Features::extract(game.getGrid(), scratch.resource());
+        std::array<int, GameState::cells> row = {};
+        std::copy(extracted.begin(), extracted.end(), row.begin());
+        found = features.emplace(key, row).first;
+    }
+    const int move = model.predict(found->second);
+    if (game.canPlace(move)) {
+        return move;
+    }
+    illegal++;
+    return random.chooseMove(game, rng);
+}
+
+const char* policySpecHelp() {
+    return "Policies: random, perfect, epsilon:<probability>, search, search:<depth>, mcts, mcts:<ms>, mcts:<ms>:<threads>, model, native, native:<weights file>";
+}
+
+bool isPolicySpec(const std::string& spec) {
+    if (spec.rfind("epsilon:", 0) == 0) {
+        const double epsilon = atof(spec.c_str() + 8);
+        return epsilon >= 0.0 && epsilon <= 1.0;
+    }
+    if (spec.rfind("search:", 0) == 0) {
+        return atoi(spec.c_str() + 7) > 0;
+    }
+    if (spec.rfind("mcts:", 0) == 0) {
+        const size_t threads = spec.find(':', 5);
+        return atoi(spec.c_str() + 5) > 0 && (threads == std::string::npos || atoi(spec.c_str() + threads + 1) > 0);
+    }
+    if (spec.rfind("native:", 0) == 0) {
+        return spec.size() > 7;
+    }
+    return spec == "random" || spec == "search" || spec == "mcts" || spec == "perfect" || spec == "model" || spec == "native";
+}
+
+std::unique_ptr<Policy> createPolicy(const std::string& spec, std::shared_ptr<ModelPool> modelPool) {
+    if (!isPolicySpec(spec)) {
+        return nullptr;
+    }
+    if (spec == "random") {
+        return std::make_unique<RandomPolicy>();
+    }
+    if (spec == "perfect") {
+        return std::make_unique<PerfectPolicy>();
+    }
+    if (spec == "model") {
+        return std::make_unique<ModelPolicy>(std::move(modelPool));
+    }
+    if (spec.rfind("native", 0) == 0) {
+        return std::make_unique<NativeModelPolicy>(spec == "native" ? TTT::nativeModelPath : spec.substr(7));
+    }
+    if (spec.rfind("search", 0) == 0) {
+        return std::make_unique<SearchPolicy>(spec == "search" ? 0 : atoi(spec.c_str() + 7));
+    }
+    if (spec.rfind("mcts", 0) == 0) {
+        if (spec == "mcts") {
+            return std::make_unique<MctsPolicy>();
+        }
+        const size_t threads = spec.find(':', 5);
+        return std::make_unique<MctsPolicy>(atoi(spec.c_str() + 5), threads == std::string::npos ? 1 : atoi(spec.c_str() + threads + 1));
+    }
+    return std::make_unique<EpsilonGreedyPolicy>(atof(spec.c_str() + 8));
+}
@@ -0,0 +1,151 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "constants.h"
+#include "gameState.h"
+#include "mcts.h"
+#include "modelPool.h"
+#include "nativeModel.h"
+#include "search.h"
+
+class Policy {
+    // Something that picks moves, so games can be played without anyone clicking.
+    // A policy may keep state between moves (e.g. a model subprocess), so each thread should have its own.
+    public:
+        // Pick a legal move for whoever's turn it is.
+        // Returns -1 if there are no moves left.
+        virtual int chooseMove(const GameState& game, std::mt19937& rng) = 0;
+
+        // Moves where the policy's first choice was illegal and had to be replaced, since it was made.
+        // Only models make them.
+        virtual std::uint64_t illegalMoves() const {return 0;}
+
+        virtual ~Policy() = default;
+};
+
+class RandomPolicy : public Policy {
+    // Plays any legal move
+    public:
+        int chooseMove(const GameState& game, std::mt19937& rng) override;
+};
+
+class PerfectPolicy : public Policy {
+    // Plays the best move according to a full minimax search. When several moves are
+    // equally good one of them is picked at random, so games aren't all the same.
+    // Wins are worth more the sooner they happen (and losses less the later they happen).
+    public:
+        int chooseMove(const GameState& game, std::mt19937& rng) override;
+
+        // The score of a position for the player whose turn it is
+        static int score(const GameState& game);
+
+    private:
+        // The score of every canonical position (see Symmetry::canonicalize). Symmetric positions
+        // share a score, so this is about 8 times smaller than storing every position.
+        // Solved once and shared by every thread.
+        static const std::unordered_map<std::uint32_t, signed char>& table();
+};
+
+class EpsilonGreedyPolicy : public Policy {
+    // Plays a random move with probability epsilon, and the perfect move otherwise
+    public:
+        explicit EpsilonGreedyPolicy(const double epsilon) : epsilon(epsilon) {}
+        int chooseMove(const GameState& game, std::mt19937& rng) override;
+
+    private:
+        double epsilon;
+        RandomPolicy random;
+        PerfectPolicy perfect;
+};
+
+class SearchPolicy : public Policy {
+    // Plays the best move according to an alpha-beta search (see SearchEngine), picking randomly
+    // between equally good moves. Searches to the end of the game unless given a depth limit.
+    // The transposition table is kept between moves, so later moves of a game are nearly free.
+    public:
+        explicit SearchPolicy(const int maxDepth = 0) : engine(maxDepth) {}
+        int chooseMove(const GameState& game, std::mt19937& rng) override {return engine.chooseMove(game, rng);}
+
+    private:
+        SearchEngine<GameState> engine;
+};
+
+class MctsPolicy : public Policy {
+    // Plays the move Monte Carlo tree search (see MctsEngine) likes best after thinking for budgetMs,
+    // on its own threads. Each move is searched from scratch.
+    public:
+        explicit MctsPolicy(const int budgetMs = TTT::mctsBudgetMs, const int threads = 1) : engine(threads, budgetMs) {}
+        int chooseMove(const GameState& game, std::mt19937& rng) override {return engine.chooseMove(game, rng);}
+
+    private:
+        MctsEngine<GameState> engine;
+};
+
+class ModelPolicy : public Policy {
+    // Asks our Python model for moves, using the same RQSTMV/RSPMV messages as the game.
+    // Requests go through a ModelPool, which may be shared by many policies (e.g. one per selfplay thread).
+    // Without one, the policy starts its own single model, waiting until it says it's ready.
+    // While the model is down (the pool restarts it) the perfect policy plays instead, and if the
+    // model keeps suggesting illegal moves a random move is played, like the model does itself.
+    public:
+        explicit ModelPolicy(std::shared_ptr<ModelPool> pool = nullptr);
+        int chooseMove(const GameState& game, std::mt19937& rng) override;
+
+        // Check if the model is up and answering
+        bool isReady() const {return pool->isReady();}
+
+        std::uint64_t illegalMoves() const override {return illegal;}
+
+    private:
+        std::shared_ptr<ModelPool> pool;
+        PerfectPolicy fallback;
+        RandomPolicy random;
+        std::uint64_t illegal = 0;
+};
+
+class NativeModelPolicy : public Policy {
+    // Plays the model's move without Python, running the MLP model.py trained (see NativeModel) in
+    // this process. The model always gives the same answer for the same features, so an illegal
+    // move is replaced with a random one straight away rather than after asking again. If the weights
+    // can't be loaded the perfect policy plays instead, like ModelPolicy when the model is down.
+    // Every board's features are drawn once and kept.
+    public:
+        explicit NativeModelPolicy(const std::string& path = TTT::nativeModelPath);
+        int chooseMove(const GameState& game, std::mt19937& rng) override;
+        std::uint64_t illegalMoves() const override {return illegal;}
+
+        bool isLoaded() const {return model.isLoaded();}
+
+    private:
+        NativeModel model;
+        std::unordered_map<std::uint32_t, std::array<int, GameState::cells>> features; // By Symmetry::key
+        PerfectPolicy fallback;
+        RandomPolicy random;
+        std::uint64_t illegal = 0;
+};
+
+// Create a policy from its name:
+//  - "random"
+//  - "perfect"
+//  - "epsilon:<probability>" e.g. "epsilon:0.1"
+//  - "search" or "search:<depth>" e.g. "search:4"
+//  - "mcts", "mcts:<milliseconds>" or "mcts:<milliseconds>:<threads>" e.g. "mcts:500:4"
+//  - "model" (using modelPool if given, otherwise starting its own model)
+//  - "native" or "native:<weights file>" (the model run in C++, from TTT::nativeModelPath by default)
+// Returns nullptr for anything else.
+std::unique_ptr<Policy> createPolicy(const std::string& spec, std::shared_ptr<ModelPool> modelPool = nullptr);
+
+// Check a policy name without creating it (a model policy starts a subprocess)
+bool isPolicySpec(const std::string& spec);
+
+// One line listing the policy names createPolicy takes, for the tools' usage messages
+const char* policySpecHelp();
+
+#endif
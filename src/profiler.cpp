@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "profiler.h"
+
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::toggle() {
+    enabled = !enabled;
+    // Start from a clean slate so old samples don't skew the next report
+    series.clear();
+    frameCount = 0;
+    std::cout << "PROFILING = " << enabled << std::endl;
+}
+
+void Profiler::record(const std::string& name, const double milliseconds) {
+    if (!enabled) {
+        return;
+    }
+    Series& s = series[name];
+    s.samples[s.next] = milliseconds;
+    s.next = (s.next + 1) % windowSize;
+    s.count = std::min(s.count + 1, windowSize);
+}
+
+void Profiler::endFrame() {
+    if (!enabled) {
+        return;
+    }
+    frameCount++;
+    if (frameCount % reportInterval == 0) {
+        report();
+    }
+}
+
+void Profiler::report() {
+    // Percentiles over the last windowSize samples of each section
+    std::cout << "---------------- PROFILE (ms, last " << windowSize << " samples) ----------------" << std::endl;
+    std::cout << std::left << std::setw(20) << "section" << std::right
+              << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "max"
+              << std::setw(8) << "n" << std::endl;
+    for (const auto& [name, s] : series) {
+        if (s.count == 0) {
+            continue;
+        }
+        std::vector<double> sorted(s.samples.begin(), s.samples.begin() + s.count);
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&sorted](const double p) {
+            return sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+        };
+        std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(10) << percentile(0.50) << std::setw(10) << percentile(0.95)
+                  << std::setw(10) << percentile(0.99) << std::setw(10) << sorted.back()
+                  << std::setw(8) << s.count << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+ScopeTimer::ScopeTimer(const char* name) : name(name), active(Profiler::get().isEnabled()) {
+    if (active) {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+ScopeTimer::~ScopeTimer() {
+    if (active) {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        Profiler::get().record(name, std::chrono::duration<double, std::milli>(elapsed).count());
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <string>
+
+class Profiler {
+    // Collect timings for named sections of each frame and report rolling percentiles.
+    // There is one profiler for the whole program (see Profiler::get()) and it is only
+    // used from the render thread, so there's no locking.
+    public:
+        // The number of samples kept for each section
+        static constexpr int windowSize = 256;
+
+        // Report once every this many frames
+        static constexpr int reportInterval = 144;
+
+        // Get the program's profiler
+        static Profiler& get();
+
+        // Turn profiling on and off. Nothing is recorded while it's off.
+        void toggle();
+        bool isEnabled() {return enabled;}
+
+        // Record a sample for a section, in milliseconds
+        void record(const std::string& name, const double milliseconds);
+
+        // Call at the end of every frame. Prints a report every reportInterval frames.
+        void endFrame();
+
+        // Print p50/p95/p99/max for every section to the console
+        void report();
+
+    private:
+        struct Series {
+            std::array<double, windowSize> samples = {};
+            int next = 0;
+            int count = 0;
+        };
+
+        bool enabled = false;
+        int frameCount = 0;
+
+        // Ordered so the report always lists sections in the same order
+        std::map<std::string, Series> series;
+};
+
+class ScopeTimer {
+    // Time the enclosing scope on the CPU and record it with the profiler on exit
+    public:
+        ScopeTimer(const char* name);
+        ~ScopeTimer();
+
+    private:
+        const char* name;
+        bool active;
+        std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arena.h"
+#include "boardFeatures.h"
+#include "constants.h"
+#include "dataset.h"
+#include "gameState.h"
+#include "symmetry.h"
+#include "threadPool.h"
+
+// Make a log's rows again from its boards file (written next to every log by the game and selfplay,
+// see Features::boardsPath) with the current feature extractor, so changing the features doesn't
+// throw the training data away. There are only 3^9 ways to fill the board, and far fewer come up in
+// games, so every distinct board is drawn once, spread across the cores, and every row after that
+// is a table lookup. With --pyramid, a dataset of each row's feature pyramid (see Dataset) is written
+// too, from the same drawing of every board.
+
+namespace {
+    constexpr int boardCount = 19683; // 3^9
+
+    // Cells as base 3 digits, the first cell lowest
+    int boardIndex(const GameState::Grid& grid) {
+        int index = 0;
+        for (int cell = GameState::cells - 1; cell >= 0; cell--) {
+            index = index * 3 + grid[cell / GameState::cols][cell % GameState::cols];
+        }
+        return index;
+    }
+
+    GameState::Grid boardGrid(int index) {
+        GameState::Grid grid;
+        for (int cell = 0; cell < GameState::cells; cell++) {
+            grid[cell / GameState::cols][cell % GameState::cols] = static_cast<GameState::CellState>(index % 3);
+            index /= 3;
+        }
+        return grid;
+    }
+
+    // Symmetry::key of the board with an index
+    std::uint32_t boardKey(int index) {
+        GameState::Bitboard xBits = 0;
+        GameState::Bitboard circleBits = 0;
+        for (int cell = 0; cell < GameState::cells; cell++, index /= 3) {
+            xBits |= static_cast<GameState::Bitboard>(index % 3 == GameState::X) << cell;
+            circleBits |= static_cast<GameState::Bitboard>(index % 3 == GameState::CIRCLE) << cell;
+        }
+        return Symmetry::key(xBits, circleBits);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Parse command line flags
+    const std::string csvPath = std::filesystem::path(CSV_PATH).string();
+    std::string inPath = csvPath + "/out_log_boards.csv";
+    std::string outPath = csvPath + "/out_log_refeaturized.csv";
+    unsigned int threads = 0;
+    std::string pyramidLevels;
+    int pyramidBits = 4;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--in" && hasValue) {
+            inPath = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            outPath = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            threads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--pyramid" && hasValue) {
+            pyramidLevels = argv[++i];
+        } else if (arg == "--pyramid-bits" && hasValue) {
+            pyramidBits = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: refeaturize [--in BOARDS_FILE] [--out FILE] [--threads N] [--pyramid LEVELS [--pyramid-bits 4|8]]" << std::endl;
+            return -1;
+        }
+    }
+    Features::Pyramid pyramid;
+    if (!pyramidLevels.empty() && !Features::parsePyramid(pyramidLevels, pyramidBits, pyramid)) {
+        return -1;
+    }
+
+    // Read every board. A row is kept as its board's index and its move, 4 bits up.
+    const auto start = std::chrono::steady_clock::now();
+    std::ifstream in(inPath, std::ios::binary);
+    if (!in) {
+        std::cerr << "ERROR::REFEATURIZE::CANNOT_OPEN " << inPath << std::endl;
+        return -1;
+    }
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::vector<std::uint32_t> rows;
+    rows.reserve(data.size() / (GameState::cells + 3));
+    std::vector<bool> needed(boardCount, false);
+    size_t skipped = 0;
+    for (size_t lineStart = 0; lineStart < data.size();) {
+        size_t lineEnd = data.find('\n', lineStart);
+        if (lineEnd == std::string::npos) {
+            lineEnd = data.size();
+        }
+        GameState::Grid grid;
+        int move = -1;
+        if (Features::parseBoard(std::string_view(data).substr(lineStart, lineEnd - lineStart), grid, move)) {
+            const int index = boardIndex(grid);
+            rows.push_back(static_cast<std::uint32_t>(index) << 4 | static_cast<std::uint32_t>(move));
+            needed[index] = true;
+        } else if (lineEnd > lineStart) {
+            skipped++;
+        }
+        lineStart = lineEnd + 1;
+    }
+    const auto parsed = std::chrono::steady_clock::now();
+
+    // Draw every distinct board once. Each row is kept formatted up to the move, and its pyramid next to it.
+    std::vector<int> boards;
+    for (int index = 0; index < boardCount; index++) {
+        if (needed[index]) {
+            boards.push_back(index);
+        }
+    }
+    std::vector<std::string> table(boardCount);
+    std::vector<std::vector<std::uint8_t>> pyramids(pyramid.enabled() ? boardCount : 0);
+    {
+        ThreadPool pool(threads);
+        const size_t chunk = 16;
+        for (size_t first = 0; first < boards.size(); first += chunk) {
+            pool.submit([&, first](const int) {
+                for (size_t i = first; i < std::min(first + chunk, boards.size()); i++) {
+                    Arena::Scope scratch;
+                    const auto pixels = Features::rasterize(boardGrid(boards[i]), TTT::screenWidth, TTT::screenHeight, scratch.resource());
+                    std::string row = Features::formatRow(Features::reduceTile(pixels.data(), TTT::screenWidth * 3, TTT::screenWidth, TTT::screenHeight, scratch.resource()), -1);
+                    row.erase(row.rfind(',') + 1);
+                    table[boards[i]] = std::move(row);
+                    if (pyramid.enabled()) {
+                        const auto levels = Features::pyramid(pixels.data(), TTT::screenWidth * 3, TTT::screenWidth, TTT::screenHeight, pyramid, scratch.resource());
+                        pyramids[boards[i]].assign(levels.begin(), levels.end());
+                    }
+                }
+            });
+        }
+        pool.wait();
+    }
+    const auto drawn = std::chrono::steady_clock::now();
+
+    // Write the rows in the order of the boards, a block at a time
+    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "ERROR::REFEATURIZE::CANNOT_OPEN " << outPath << std::endl;
+        return -1;
+    }
+    std::string block = "1,2,3,4,5,6,7,8,9,next_move\n";
+    for (const std::uint32_t row : rows) {
+        block += table[row >> 4];
+        block += static_cast<char>('0' + (row & 0xf));
+        block += '\n';
+        if (block.size() >= (1 << 20)) {
+            out << block;
+            block.clear();
+        }
+    }
+    out << block;
+    out.close();
+
+    // And every row's pyramid, to a new dataset
+    const std::string datasetPath = Features::datasetPath(outPath);
+    if (pyramid.enabled()) {
+        std::error_code error;
+        std::filesystem::remove(datasetPath, error);
+        Dataset dataset;
+        if (!dataset.open(datasetPath, pyramid)) {
+            return -1;
+        }
+        for (const std::uint32_t row : rows) {
+            dataset.append(boardKey(static_cast<int>(row >> 4)), static_cast<int>(row & 0xf), pyramids[row >> 4]);
+        }
+    }
+    const auto written = std::chrono::steady_clock::now();
+
+    auto seconds = [](const auto from, const auto to) {return std::chrono::duration<double>(to - from).count();};
+    std::cout << "Read " << rows.size() << " boards from " << inPath << " in " << seconds(start, parsed) << " s";
+    if (skipped > 0) {
+        std::cout << " (skipped " << skipped << " lines that aren't boards)";
+    }
+    std::cout << std::endl;
+    std::cout << "Drew " << boards.size() << " distinct boards in " << seconds(parsed, drawn) << " s" << std::endl;
+    std::cout << "Wrote " << rows.size() << " rows to " << outPath << " in " << seconds(drawn, written) << " s ("
+              << static_cast<size_t>(rows.size() / std::max(seconds(start, written), 1e-9)) << " rows/s overall)" << std::endl;
+    if (pyramid.enabled()) {
+        std::cout << "Wrote " << rows.size() << " pyramids of " << pyramid.cells() << " features to " << datasetPath << std::endl;
+    }
+    return 0;
+}
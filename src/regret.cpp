@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "arena.h"
+#include "boardFeatures.h"
+#include "constants.h"
+#include "gameState.h"
+#include "modelPool.h"
+#include "nativeModel.h"
+#include "policy.h"
+#include "symmetry.h"
+#include "threadPool.h"
+
+// Score how well a policy plays, rather than how often it agrees with recorded moves.
+// Every position that can come up in a game is given to the policy once, and its move is checked
+// against perfect play: does it keep the position's game-theoretic value (a won position stays won,
+// a drawn one drawn), and is it one of the best moves? The results are broken down by move number.
+// The model is asked about every position in a single batched request (RQSTBATCH), and the native
+// model is run directly, so both are scored on their first choice even when it's illegal.
+
+namespace {
+    // -1, 0 or 1: lost, drawn or won for the player to move
+    int outcome(const int score) {
+        return (score > 0) - (score < 0);
+    }
+
+    // Every position reachable from this one that still has a move to play, once each.
+    // Finished games are counted but not kept.
+    void collect(const GameState& game, std::unordered_set<std::uint32_t>& seen, std::vector<GameState>& positions, size_t& finished) {
+        if (!seen.insert(Symmetry::key(game.getBits(GameState::X), game.getBits(GameState::CIRCLE))).second) {
+            return;
+        }
+        if (game.isOver()) {
+            finished++;
+            return;
+        }
+        positions.push_back(game);
+        for (int cell = 0; cell < GameState::cells; cell++) {
+            GameState next = game;
+            if (next.playMove(cell)) {
+                collect(next, seen, positions, finished);
+            }
+        }
+    }
+
+    // Totals for the positions at one move number
+    struct Tally {
+        size_t positions = 0;
+        size_t illegal = 0;
+        size_t kept = 0; // Moves that kept the position's value
+        size_t best = 0; // Moves as good as the best one
+        std::array<size_t, 3> drops = {}; // win -> draw, win -> loss, draw -> loss
+
+        void add(const Tally& other) {
+            positions += other.positions;
+            illegal += other.illegal;
+            kept += other.kept;
+            best += other.best;
+            for (int i = 0; i < 3; i++) {
+                drops[i] += other.drops[i];
+            }
+        }
+    };
+
+    std::string percent(const size_t count, const size_t total) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << (total ? 100.0 * count / total : 0.0) << "%";
+        return out.str();
+    }
+
+    void printRow(const std::string& label, const Tally& tally) {
+        // Regret is how many steps the outcome fell (win to draw is 1, win to loss is 2), per position
+        const double regret = tally.positions ? static_cast<double>(tally.drops[0] + 2 * tally.drops[1] + tally.drops[2]) / tally.positions : 0.0;
+        std::cout << std::setw(5) << label << std::setw(11) << tally.positions << std::setw(9) << percent(tally.illegal, tally.positions)
+                  << std::setw(12) << percent(tally.kept, tally.positions) << std::setw(11) << percent(tally.best, tally.positions)
+                  << std::setw(11) << tally.drops[0] << std::setw(11) << tally.drops[1] << std::setw(12) << tally.drops[2]
+                  << std::setw(9) << std::fixed << std::setprecision(3) << regret << std::defaultfloat << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Parse command line flags
+    std::string spec = "model";
+    unsigned int threads = 0;
+    std::uint32_t seed = std::random_device()();
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--policy" && hasValue) {
+            spec = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            threads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: regret [--policy POLICY] [--threads N] [--seed N]" << std::endl;
+            std::cerr << policySpecHelp() << std::endl;
+            return -1;
+        }
+    }
+    if (!isPolicySpec(spec)) {
+        std::cerr << "ERROR::REGRET::UNKNOWN_POLICY " << spec << std::endl;
+        std::cerr << policySpecHelp() << std::endl;
+        return -1;
+    }
+
+    std::unordered_set<std::uint32_t> seen;
+    std::vector<GameState> positions;
+    size_t finished = 0;
+    collect(GameState(), seen, positions, finished);
+    std::cout << "Scoring " << spec << " on " << positions.size() << " positions (" << seen.size() << " reachable, "
+              << finished << " of them finished games)" << std::endl;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<int> moves(positions.size(), -1);
+    const bool model = spec == "model";
+    const bool native = spec.rfind("native", 0) == 0;
+    if (model || native) {
+        // Draw every board's features, spread across the cores
+        std::vector<std::array<int, GameState::cells>> features(positions.size());
+        {
+            ThreadPool pool(threads);
+            const size_t chunk = 64;
+            for (size_t first = 0; first < positions.size(); first += chunk) {
+                pool.submit([&, first](const int) {
+                    for (size_t i = first; i < std::min(first + chunk, positions.size()); i++) {
+                        Arena::Scope scratch;
+                        const auto extracted = Features::extract(positions[i].getGrid(), scratch.resource());
+                        std::copy(extracted.begin(), extracted.end(), features[i].begin());
+                    }
+                });
+            }
+            pool.wait();
+        }
+        std::cout << "Drew the features in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+
+        const auto askStart = std::chrono::steady_clock::now();
+        if (model) {
+            ModelPool modelPool(1, TTT::modelCommand);
+            if (!modelPool.waitUntilReady(TTT::modelStartTimeoutMs)) {
+                std::cerr << "ERROR::REGRET::MODEL_NOT_READY" << std::endl;
+                return -1;
+            }
+            std::vector<std::string> rows;
+            rows.reserve(positions.size());
+            for (const auto& row : features) {
+                rows.push_back(Features::formatRow(row, -1));
+            }
+            std::vector<int> replies;
+            const auto sent = std::chrono::steady_clock::now();
+            if (modelPool.requestBatch(rows, replies).get() != static_cast<int>(positions.size())) {
+                std::cerr << "ERROR::REGRET::BAD_BATCH_REPLY, " << replies.size() << " moves for " << positions.size() << " positions" << std::endl;
+                return -1;
+            }
+            moves = replies;
+            std::cout << "The model answered all " << positions.size() << " positions in one request in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sent).count() << " ms" << std::endl;
+        } else {
+            NativeModel network;
+            if (!network.load(spec == "native" ? TTT::nativeModelPath : spec.substr(7))) {
+                return -1;
+            }
+            for (size_t i = 0; i < positions.size(); i++) {
+                moves[i] = network.predict(features[i]);
+            }
+            std::cout << "The native model answered in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - askStart).count() << " ms" << std::endl;
+        }
+    } else {
+        const auto policy = createPolicy(spec);
+        std::mt19937 rng(seed);
+        for (size_t i = 0; i < positions.size(); i++) {
+            moves[i] = policy->chooseMove(positions[i], rng);
+        }
+    }
+
+    // Check every move against perfect play
+    std::array<Tally, GameState::cells> byMove = {};
+    for (size_t i = 0; i < positions.size(); i++) {
+        const GameState& game = positions[i];
+        Tally& tally = byMove[game.getMoveCount()];
+        tally.positions++;
+        GameState next = game;
+        if (!next.playMove(moves[i])) {
+            tally.illegal++;
+            continue;
+        }
+        const int best = PerfectPolicy::score(game);
+        const int score = -PerfectPolicy::score(next);
+        tally.kept += outcome(score) == outcome(best);
+        tally.best += score == best;
+        if (outcome(best) == 1 && outcome(score) == 0) tally.drops[0]++;
+        if (outcome(best) == 1 && outcome(score) == -1) tally.drops[1]++;
+        if (outcome(best) == 0 && outcome(score) == -1) tally.drops[2]++;
+    }
+
+    // Illegal moves count as neither kept nor best, but not as a drop either
+    std::cout << " move  positions  illegal  kept value  best move   win>draw   win>loss   draw>loss   regret" << std::endl;
+    Tally all;
+    for (int move = 0; move < GameState::cells; move++) {
+        printRow(std::to_string(move + 1), byMove[move]);
+        all.add(byMove[move]);
+    }
+    printRow("all", all);
+    return 0;
+}
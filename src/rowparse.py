@@ -0,0 +1,114 @@
+# Fast parsing of training rows into numpy arrays.
+# Every feature is a single hex digit and every move a single digit, so a row of the log is
+# always "f,f,f,f,f,f,f,f,f,m". Instead of converting cells one at a time in Python, we look
+# every byte up in a table at once.
+import numpy as np
+
+# The value of the hex digit in each byte, or 255 if the byte isn't one
+HEX_LUT = np.full(256, 255, dtype=np.uint8)
+for value, digit in enumerate(b"0123456789abcdef"):
+    HEX_LUT[digit] = value
+for value, digit in enumerate(b"ABCDEF"):
+    HEX_LUT[digit] = 10 + value
+
+ROW_WIDTH = 19 # Bytes in a row, not counting the line ending
+COLUMNS = 10 # 9 features and the move
+BLOCK_ROWS = 1 << 20 # Rows parsed at a time on the slow path, to bound the size of the index arrays
+
+def empty_rows():
+    return np.empty((0, 9), dtype=np.uint8), np.empty(0, dtype=np.uint8)
+
+def split_values(values):
+    # Split parsed rows into features and moves, dropping any that aren't valid rows
+    ok = (values != 255).all(axis=1) & (values[:, 9] <= 8)
+    values = values[ok]
+    return values[:, :9], values[:, 9]
+
+def parse_fixed_width(data, width):
+    # Every line is the same width (a row plus its line ending), so the buffer is just a 2D array
+    lines = data.reshape(-1, width)
+    if not (lines[:, 1:ROW_WIDTH:2] == ord(",")).all():
+        return None
+    return split_values(HEX_LUT[lines[:, 0:ROW_WIDTH:2]])
+
+def parse_lines(data):
+    # Lines of any width, e.g. a header or a mix of \n and \r\n endings. Rows are found by
+    # where each line starts, and lines that aren't exactly a row are skipped.
+    ends = np.flatnonzero(data == ord("\n"))
+    if len(ends) == 0:
+        return empty_rows()
+    starts = np.empty_like(ends)
+    starts[0] = 0
+    starts[1:] = ends[:-1] + 1
+    lengths = ends - starts
+    long_enough = lengths >= ROW_WIDTH
+    starts = starts[long_enough]
+    lengths = lengths[long_enough]
+
+    features = []
+    classes = []
+    for first in range(0, len(starts), BLOCK_ROWS):
+        block_starts = starts[first:first + BLOCK_ROWS]
+        block_lengths = lengths[first:first + BLOCK_ROWS]
+        # The line has to end right after the move (allowing a \r)
+        ok = (block_lengths == ROW_WIDTH) | ((block_lengths == ROW_WIDTH + 1) & (data[block_starts + ROW_WIDTH] == ord("\r")))
+        ok &= (data[block_starts[:, None] + np.arange(1, ROW_WIDTH, 2)] == ord(",")).all(axis=1)
+        block_features, block_classes = split_values(HEX_LUT[data[block_starts[ok, None] + np.arange(0, ROW_WIDTH, 2)]])
+        features.append(block_features)
+        classes.append(block_classes)
+    return np.concatenate(features), np.concatenate(classes)
+
+def parse_log_bytes(buf):
+    # Parse complete lines of a training log. Returns the features (an N x 9 array) and moves as uint8.
+    data = np.frombuffer(buf, dtype=np.uint8)
+    if len(data) == 0:
+        return empty_rows()
+
+    # Logs written by the game or selfplay are all rows of the same width, which can be read
+    # without copying or building any index arrays
+    newline = buf.find(b"\n")
+    if newline in (ROW_WIDTH, ROW_WIDTH + 1) and len(data) % (newline + 1) == 0:
+        width = newline + 1
+        if (data[width - 1::width] == ord("\n")).all() and (width == ROW_WIDTH + 1 or (data[ROW_WIDTH::width] == ord("\r")).all()):
+            parsed = parse_fixed_width(data, width)
+            if parsed is not None:
+                return parsed
+    return parse_lines(data)
+
+def parse_frame(data):
+    # Parse the features and moves of a DataFrame of rows (e.g. a compacted log read by pandas).
+    # Each feature cell is one character, so a whole column joins into a byte string we can look up at once.
+    columns = [HEX_LUT[np.frombuffer(data.iloc[:, i].astype(str).str.cat().encode(), dtype=np.uint8)] for i in range(9)]
+    return np.stack(columns, axis=1), data.iloc[:, 9].values.astype(np.uint8)
+
+def parse_cells(cells):
+    # Parse the 9 features of a single request, e.g. ["1", "a", ...], into a 1 x 9 array
+    return HEX_LUT[np.frombuffer("".join(cell.strip() for cell in cells[0:9]).encode(), dtype=np.uint8)].reshape(1, 9)
+
+def read_dataset(path):
+    # Read a dataset of feature pyramids (see dataset.h). Returns the levels, the boards (each
+    # x bits | circle bits << 9), the moves, and the pyramids (an N x features array, every level
+    # one after another). Records are fixed width, so the file is read as one 2D array.
+    data = np.fromfile(path, dtype=np.uint8)
+    if bytes(data[:6]) != b"TTTSET" or data[6] != 1:
+        raise ValueError(f"{path} isn't a dataset")
+    bits = int(data[7])
+    levels = [int(level) for level in data[9:9 + 2 * data[8]].view("<u2")]
+    at = 9 + 2 * len(levels)
+    record = int(data[at:at + 4].view("<u4")[0])
+    records = data[at + 4:]
+    records = records[:len(records) - len(records) % record].reshape(-1, record)
+
+    boards = records[:, 0:4].copy().view("<u4")[:, 0]
+    moves = records[:, 4]
+    cells = sum(level * level for level in levels)
+    if bits == 8:
+        pyramids = records[:, 5:5 + cells]
+    else:
+        # Two features a byte, the first in the low nibble
+        packed = records[:, 5:]
+        pyramids = np.empty((len(records), packed.shape[1] * 2), dtype=np.uint8)
+        pyramids[:, 0::2] = packed & 0xf
+        pyramids[:, 1::2] = packed >> 4
+        pyramids = pyramids[:, :cells]
+    return levels, boards, moves, pyramids
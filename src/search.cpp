@@ -0,0 +1,216 @@
+#include <algorithm>
+
+#include "search.h"
+#include "arena.h"
+
+namespace {
+    // splitmix64, to fill the Zobrist keys with well mixed bits at compile time
+    constexpr std::uint64_t splitmix64(std::uint64_t& state) {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    template <int Cells>
+    struct ZobristKeys {
+        std::array<std::array<std::uint64_t, Cells>, 2> cells = {}; // [turn][cell], turn 0 is X
+        std::uint64_t circleToMove = 0;
+    };
+
+    template <int Cells>
+    constexpr ZobristKeys<Cells> buildKeys() {
+        ZobristKeys<Cells> keys;
+        std::uint64_t state = 0x7474745F6D6C0001ULL;
+        for (auto& player : keys.cells) {
+            for (auto& key : player) {
+                key = splitmix64(state);
+            }
+        }
+        keys.circleToMove = splitmix64(state);
+        return keys;
+    }
+
+    template <int Cells>
+    constexpr ZobristKeys<Cells> zobrist = buildKeys<Cells>();
+
+    // Cells in more lines first, e.g. on 3x3 the center (4 lines), then corners (3), then edges (2).
+    // Ties go in the order the cells are numbered.
+    template <typename Game>
+    const std::array<int, Game::cells>& staticOrder() {
+        static const std::array<int, Game::cells> order = [] {
+            std::array<int, Game::cells> linesThrough = {};
+            for (const std::uint64_t mask : Game::lineMasks()) {
+                for (int cell = 0; cell < Game::cells; cell++) {
+                    linesThrough[cell] += (mask >> cell) & 1;
+                }
+            }
+            std::array<int, Game::cells> cells;
+            for (int cell = 0; cell < Game::cells; cell++) {
+                cells[cell] = cell;
+            }
+            std::stable_sort(cells.begin(), cells.end(), [&](const int a, const int b) {return linesThrough[a] > linesThrough[b];});
+            return cells;
+        }();
+        return order;
+    }
+}
+
+template <typename Game>
+SearchEngine<Game>::SearchEngine(const int maxDepth, const int tableBits) : maxDepth(maxDepth), table(size_t(1) << tableBits), tableMask((std::uint64_t(1) << tableBits) - 1) {}
+
+template <typename Game>
+std::uint64_t SearchEngine<Game>::hash(const Game& game) {
+    const auto& keys = zobrist<Game::cells>;
+    std::uint64_t key = game.getTurn() == 1 ? keys.circleToMove : 0;
+    for (int cell = 0; cell < Game::cells; cell++) {
+        if ((game.getBits(Game::X) >> cell) & 1) key ^= keys.cells[0][cell];
+        if ((game.getBits(Game::CIRCLE) >> cell) & 1) key ^= keys.cells[1][cell];
+    }
+    return key;
+}
+
+template <typename Game>
+void SearchEngine<Game>::clearTable() {
+    std::fill(table.begin(), table.end(), Entry());
+}
+
+template <typename Game>
+int SearchEngine<Game>::evaluate(const Game& game) {
+    const std::uint64_t mine = game.getBits(game.getTurn() == 0 ? Game::X : Game::CIRCLE);
+    const std::uint64_t theirs = game.getBits(game.getTurn() == 0 ? Game::CIRCLE : Game::X);
+    int result = 0;
+    for (const std::uint64_t line : Game::lineMasks()) {
+        if (!(line & theirs)) result++;
+        if (!(line & mine)) result--;
+    }
+    return result;
+}
+
+template <typename Game>
+std::array<int, Game::cells> SearchEngine<Game>::orderMoves(const Game& game, const int tableMove, int& count) const {
+    std::array<int, Game::cells> moves = {};
+    count = 0;
+    if (game.canPlace(tableMove)) {
+        moves[count++] = tableMove;
+    }
+    for (const int cell : staticOrder<Game>()) {
+        if (cell != tableMove && game.canPlace(cell)) {
+            moves[count++] = cell;
+        }
+    }
+    return moves;
+}
+
+template <typename Game>
+int SearchEngine<Game>::negamax(const Game& game, const std::uint64_t key, const int depth, int alpha, int beta) {
+    stats.nodes++;
+    switch (game.getStatus()) {
+        case Game::X_WIN:
+        case Game::C_WIN:
+            return -(winScore + Game::cells - game.getMoveCount()); // Whoever just moved won
+        case Game::DRAW:
+            return 0;
+        default:
+            break;
+    }
+    if (maxDepth > 0 && depth >= maxDepth) {
+        return evaluate(game);
+    }
+
+    // A score from the table is only good enough if it was searched at least as deep as we would
+    const int remaining = maxDepth > 0 ? maxDepth - depth : 127;
+    Entry& entry = table[key & tableMask];
+    int tableMove = -1;
+    if (entry.bound != EMPTY && entry.key == key) {
+        tableMove = entry.bestMove;
+        if (entry.depth >= remaining) {
+            if (entry.bound == EXACT || (entry.bound == LOWER && entry.score >= beta) || (entry.bound == UPPER && entry.score <= alpha)) {
+                stats.tableHits++;
+                return entry.score;
+            }
+        }
+    }
+
+    const int alphaStart = alpha;
+    int best = -infinity;
+    int bestMove = -1;
+    int count = 0;
+    const std::array<int, Game::cells> moves = orderMoves(game, tableMove, count);
+    const std::uint64_t moverKey = game.getTurn() == 0 ? 0 : 1;
+    for (int i = 0; i < count; i++) {
+        Game next = game;
+        next.playMove(moves[i]);
+        const std::uint64_t childKey = key ^ zobrist<Game::cells>.cells[moverKey][moves[i]] ^ zobrist<Game::cells>.circleToMove;
+        const int moveScore = -negamax(next, childKey, depth + 1, -beta, -alpha);
+        if (moveScore > best) {
+            best = moveScore;
+            bestMove = moves[i];
+        }
+        if (best > alpha) {
+            alpha = best;
+        }
+        if (alpha >= beta) {
+            stats.cutoffs++;
+            break;
+        }
+    }
+
+    entry.key = key;
+    entry.score = static_cast<std::int16_t>(best);
+    entry.depth = static_cast<std::int8_t>(remaining);
+    entry.bestMove = static_cast<std::int8_t>(bestMove);
+    entry.bound = best <= alphaStart ? UPPER : best >= beta ? LOWER : EXACT;
+    return best;
+}
+
+template <typename Game>
+int SearchEngine<Game>::score(const Game& game) {
+    return negamax(game, hash(game), 0, -infinity, infinity);
+}
+
+template <typename Game>
+std::pmr::vector<int> SearchEngine<Game>::bestMoves(const Game& game, std::pmr::memory_resource* memory) {
+    std::pmr::vector<int> result(memory);
+    if (game.isOver()) {
+        return result;
+    }
+
+    const std::uint64_t key = hash(game);
+    const Entry& entry = table[key & tableMask];
+    int count = 0;
+    const std::array<int, Game::cells> moves = orderMoves(game, entry.key == key ? entry.bestMove : -1, count);
+    const std::uint64_t moverKey = game.getTurn() == 0 ? 0 : 1;
+    int best = -infinity;
+    for (int i = 0; i < count; i++) {
+        Game next = game;
+        next.playMove(moves[i]);
+        // A window just below the best so far still tells moves that tie it apart from worse ones
+        const int alpha = best == -infinity ? -infinity : best - 1;
+        const int moveScore = -negamax(next, key ^ zobrist<Game::cells>.cells[moverKey][moves[i]] ^ zobrist<Game::cells>.circleToMove, 1, -infinity, -alpha);
+        if (moveScore > best) {
+            best = moveScore;
+            result.clear();
+        }
+        if (moveScore == best) {
+            result.push_back(moves[i]);
+        }
+    }
+    return result;
+}
+
+template <typename Game>
+int SearchEngine<Game>::chooseMove(const Game& game, std::mt19937& rng) {
+    // The moves are only needed until we've picked one
+    Arena::Scope scratch;
+    const std::pmr::vector<int> best = bestMoves(game, scratch.resource());
+    if (best.empty()) {
+        return -1;
+    }
+    return best[std::uniform_int_distribution<size_t>(0, best.size() - 1)(rng)];
+}
+
+// The board sizes we build (see the bottom of gameState.cpp)
+template class SearchEngine<BasicGameState<3, 3, 3>>;
+template class SearchEngine<BasicGameState<4, 4, 4>>;
+template class SearchEngine<BasicGameState<5, 5, 4>>;
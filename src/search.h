@@ -0,0 +1,86 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include "gameState.h"
+
+template <typename Game>
+class SearchEngine {
+    // Negamax search with alpha-beta pruning over the game state's bitboards.
+    // Positions are hashed with Zobrist keys (a random number per cell and player, xored together,
+    // updated with one xor per move) and remembered in a fixed size transposition table, so a position
+    // reached through different move orders is only searched once. Moves are tried best first:
+    // the table's best move for the position, then cells that are part of more lines.
+    // Unlike PerfectPolicy's table this doesn't need every position up front, and a depth limit
+    // turns it into a heuristic search for boards too big to search to the end.
+    // Templated on the game state; the sizes in gameState.cpp are instantiated in search.cpp.
+    public:
+        // Win scores are bigger than any heuristic score. The sooner the win, the bigger.
+        static constexpr int winScore = 1000;
+        static constexpr int infinity = 1000000;
+
+        // Nodes searched, table lookups that answered a node, and alpha-beta cutoffs since the last clearStats()
+        struct Stats {
+            std::uint64_t nodes = 0;
+            std::uint64_t tableHits = 0;
+            std::uint64_t cutoffs = 0;
+        };
+
+        // maxDepth 0 searches to the end of the game. The table has 2^tableBits entries.
+        explicit SearchEngine(const int maxDepth = 0, const int tableBits = 16);
+
+        // The score of a position for the player whose turn it is
+        int score(const Game& game);
+
+        // Every move that's as good as the best one, allocated from memory. Empty if the game is over.
+        std::pmr::vector<int> bestMoves(const Game& game, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+        // One of the best moves, picked at random. -1 if the game is over.
+        int chooseMove(const Game& game, std::mt19937& rng);
+
+        // The Zobrist key of a position
+        static std::uint64_t hash(const Game& game);
+
+        const Stats& getStats() const {return stats;}
+        void clearStats() {stats = Stats();}
+
+        // Forget every position searched so far
+        void clearTable();
+
+    private:
+        enum Bound : std::uint8_t {
+            EMPTY = 0,
+            EXACT = 1,
+            LOWER = 2, // The score is at least this (a cutoff happened)
+            UPPER = 3 // The score is at most this (no move reached alpha)
+        };
+
+        struct Entry {
+            std::uint64_t key = 0;
+            std::int16_t score = 0;
+            std::int8_t depth = 0; // How deep the score was searched, or 127 if it was searched to the end
+            std::int8_t bestMove = -1;
+            Bound bound = EMPTY;
+        };
+
+        int negamax(const Game& game, const std::uint64_t key, const int depth, int alpha, int beta);
+
+        // Score for a position at the depth limit: lines the player to move could still complete,
+        // minus lines the other player could
+        static int evaluate(const Game& game);
+
+        // Legal moves, best first
+        std::array<int, Game::cells> orderMoves(const Game& game, const int tableMove, int& count) const;
+
+        int maxDepth;
+        std::vector<Entry> table;
+        std::uint64_t tableMask;
+        Stats stats;
+};
+
+#endif
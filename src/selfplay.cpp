@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.h"
+#include "boardFeatures.h"
+#include "constants.h"
+#include "gameState.h"
+#include "modelPool.h"
+#include "policy.h"
+#include "symmetry.h"
+#include "threadPool.h"
+
+// Generate training data by letting policies play each other, with no window and no clicking.
+// Rows have the same format CSVHandler writes (9 features and the next move), one per move,
+// for the board before the move was made, and like CSVHandler the boards themselves are written
+// to the log's boards file in the same order. Games are played in chunks on a work-stealing
+// thread pool. Every chunk fills its own buffer of rows and hands it to the main thread
+// through a lock-free stack, and the main thread is the only one that writes the file.
+// --augment also writes every distinct rotation/reflection of each row, and --dedupe only writes
+// a position and move the first time it (or any symmetry of it) comes up.
+// Model policies on every thread share one pool of model subprocesses (--model-workers).
+
+namespace {
+    // A chunk's worth of rows, linked into the stack of finished buffers
+    struct RowBuffer {
+        std::string rows;
+        std::string boards;
+        RowBuffer* next = nullptr;
+    };
+
+    // Finished buffers waiting to be written. Workers push, the main thread takes them all at once.
+    std::atomic<RowBuffer*> finishedBuffers = nullptr;
+
+    void pushBuffer(RowBuffer* buffer) {
+        buffer->next = finishedBuffers.load(std::memory_order_relaxed);
+        while (!finishedBuffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release, std::memory_order_relaxed)) {
+            // buffer->next was updated to the current head, try again
+        }
+    }
+
+    // Write every finished buffer, oldest first. Returns the number of bytes of rows written.
+    size_t drainBuffers(std::ofstream& file, std::ofstream& boardFile) {
+        RowBuffer* list = finishedBuffers.exchange(nullptr, std::memory_order_acquire);
+
+        // The stack is newest first, so reverse it
+        RowBuffer* ordered = nullptr;
+        while (list) {
+            RowBuffer* next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+
+        size_t bytes = 0;
+        while (ordered) {
+            file << ordered->rows;
+            boardFile << ordered->boards;
+            bytes += ordered->rows.size();
+            RowBuffer* next = ordered->next;
+            delete ordered;
+            ordered = next;
+        }
+        return bytes;
+    }
+
+    // Everything a worker thread keeps between chunks
+    struct WorkerState {
+        std::unique_ptr<Policy> xPolicy;
+        std::unique_ptr<Policy> oPolicy;
+    };
+
+    // Rasterizing a board is by far the slowest part of a move, and there are only a few thousand
+    // boards, so every board's features are computed once and shared by all the threads.
+    // Indexed by xBits | circleBits << 9. Whoever gets there first installs the features; if two
+    // threads race on the same board the loser throws its copy away.
+    std::vector<std::atomic<const std::string*>> featureTable(1 << 18);
+
+    const std::string& boardFeatures(const GameState::Bitboard xBits, const GameState::Bitboard circleBits) {
+        std::atomic<const std::string*>& entry = featureTable[Symmetry::key(xBits, circleBits)];
+        const std::string* features = entry.load(std::memory_order_acquire);
+        if (features) {
+            return *features;
+        }
+
+        // formatRow ends with the move, so format it without one and keep everything up to the last comma
+        GameState::Grid grid;
+        for (int cell = 0; cell < 9; cell++) {
+            grid[cell / 3][cell % 3] = (xBits & (1 << cell)) ? GameState::X : (circleBits & (1 << cell)) ? GameState::CIRCLE : GameState::CLEAR;
+        }
+        Arena::Scope scratch;
+        std::string row = Features::formatRow(Features::extract(grid, scratch.resource()), -1);
+        row.erase(row.rfind(',') + 1);
+        const std::string* created = new std::string(std::move(row));
+        if (!entry.compare_exchange_strong(features, created, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            delete created; // features now holds the winner
+            return *features;
+        }
+        return *created;
+    }
+
+    // With --dedupe, bit (canonical position * 9 + canonical move) is set once a row for that
+    // position and move (or any symmetry of it) has been written
+    std::vector<std::atomic<std::uint64_t>> seenRows((static_cast<size_t>(1 << 18) * 9 + 63) / 64);
+
+    // Returns true the first time it's called for a position and move, or any symmetry of them
+    bool firstTimeSeen(const GameState& game, const int move) {
+        const Symmetry::Canonical canonical = Symmetry::canonicalize(game);
+        const size_t bit = static_cast<size_t>(canonical.key) * 9 + Symmetry::mapCell(canonical.symmetry, move);
+        const std::uint64_t mask = std::uint64_t(1) << (bit % 64);
+        return !(seenRows[bit / 64].fetch_or(mask, std::memory_order_relaxed) & mask);
+    }
+
+    struct Results {
+        std::atomic<size_t> rows = 0;
+        std::atomic<size_t> xWins = 0;
+        std::atomic<size_t> circleWins = 0;
+        std::atomic<size_t> draws = 0;
+        std::atomic<size_t> chunksDone = 0;
+    };
+}
+
+int main(int argc, char* argv[]) {
+    // Parse command line flags
+    size_t games = 10000;
+    unsigned int threads = 0;
+    size_t chunkSize = 256;
+    std::string xSpec = "random";
+    std::string oSpec = "random";
+    std::string outPath = std::filesystem::path(CSV_PATH).string() + "/selfplay.csv";
+    std::uint32_t seed = std::random_device()();
+    bool augment = false;
+    bool dedupe = false;
+    int modelWorkers = 0;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--games" && hasValue) {
+            games = std::stoull(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            threads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--chunk" && hasValue) {
+            chunkSize = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (arg == "--x" && hasValue) {
+            xSpec = argv[++i];
+        } else if (arg == "--o" && hasValue) {
+            oSpec = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            outPath = argv[++i];
+        } else if (arg == "--seed" && hasValue) {
+            seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--model-workers" && hasValue) {
+            modelWorkers = std::stoi(argv[++i]);
+        } else if (arg == "--augment") {
+            augment = true;
+        } else if (arg == "--dedupe") {
+            dedupe = true;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: selfplay [--games N] [--threads N] [--chunk N] [--x POLICY] [--o POLICY] [--out FILE] [--seed N] [--augment] [--dedupe] [--model-workers N]" << std::endl;
+            std::cerr << policySpecHelp() << std::endl;
+            return -1;
+        }
+    }
+
+    // Make sure the policies exist before starting any threads
+    if (!isPolicySpec(xSpec) || !isPolicySpec(oSpec)) {
+        std::cerr << "ERROR::SELFPLAY::UNKNOWN_POLICY " << xSpec << " / " << oSpec << std::endl;
+        std::cerr << policySpecHelp() << std::endl;
+        return -1;
+    }
+
+    // Open the output, writing the header if it's a new file
+    const bool newFile = !std::filesystem::exists(outPath) || std::filesystem::file_size(outPath) == 0;
+    std::ofstream file(outPath, std::ios::app | std::ios::binary);
+    if (!file) {
+        std::cerr << "ERROR::SELFPLAY::CANNOT_OPEN " << outPath << std::endl;
+        return -1;
+    }
+    if (newFile) {
+        file << "1,2,3,4,5,6,7,8,9,next_move\n";
+    }
+    const std::string boardsPath = Features::boardsPath(outPath);
+    std::ofstream boardFile(boardsPath, std::ios::app | std::ios::binary);
+    if (!boardFile) {
+        std::cerr << "ERROR::SELFPLAY::CANNOT_OPEN " << boardsPath << std::endl;
+        return -1;
+    }
+
+    ThreadPool pool(threads);
+    std::vector<WorkerState> workerStates(pool.size());
+
+    // Start the models up front, one per thread unless told otherwise
+    std::shared_ptr<ModelPool> modelPool;
+    if (xSpec == "model" || oSpec == "model") {
+        modelPool = std::make_shared<ModelPool>(modelWorkers > 0 ? modelWorkers : pool.size(), TTT::modelCommand);
+        if (!modelPool->waitUntilReady(TTT::modelStartTimeoutMs)) {
+            std::cerr << "ERROR::SELFPLAY::MODEL_NOT_READY, the perfect policy will play for the model until it starts" << std::endl;
+        }
+    }
+    Results results;
+    std::cout << "Playing " << games << " games of " << xSpec << " (X) vs " << oSpec << " (O) on " << pool.size()
+              << " threads, seed " << seed << std::endl;
+
+    const auto start = std::chrono::steady_clock::now();
+    const size_t chunks = (games + chunkSize - 1) / chunkSize;
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        const size_t chunkGames = std::min(chunkSize, games - chunk * chunkSize);
+        pool.submit([&, chunk, chunkGames](const int worker) {
+            WorkerState& state = workerStates[worker];
+            if (!state.xPolicy) {
+                state.xPolicy = createPolicy(xSpec, modelPool);
+                state.oPolicy = createPolicy(oSpec, modelPool);
+            }
+
+            // Every chunk has its own generator, so a seed plays the same games whichever thread runs them
+            std::seed_seq seq = {seed, static_cast<std::uint32_t>(chunk)};
+            std::mt19937 rng(seq);
+
+            auto* buffer = new RowBuffer();
+            size_t rows = 0;
+            GameState game;
+            for (size_t g = 0; g < chunkGames; g++) {
+                // Everything the game allocates along the way goes back to this thread's arena when it ends
+                Arena::Scope gameScope;
+                game.reset();
+                while (!game.isOver()) {
+                    Policy& policy = game.getTurn() == 0 ? *state.xPolicy : *state.oPolicy;
+                    const int move = policy.chooseMove(game, rng);
+                    if (move < 0) {
+                        break;
+                    }
+                    if (!dedupe || firstTimeSeen(game, move)) {
+                        const GameState::Bitboard xBits = game.getBits(GameState::X);
+                        const GameState::Bitboard circleBits = game.getBits(GameState::CIRCLE);
+                        // Variant 0 is the board itself
+                        const std::pmr::vector<int> variants = augment ? Symmetry::distinctVariants(game.getGrid(), move, gameScope.resource())
+                                                                       : std::pmr::vector<int>(1, 0, gameScope.resource());
+                        for (const int s : variants) {
+                            buffer->rows += boardFeatures(Symmetry::mapBits(s, xBits), Symmetry::mapBits(s, circleBits));
+                            buffer->rows += std::to_string(Symmetry::mapCell(s, move));
+                            buffer->rows += '\n';
+                            buffer->boards += Features::formatBoard(Symmetry::mapGrid(s, game.getGrid()), Symmetry::mapCell(s, move));
+                            buffer->boards += '\n';
+                            rows++;
+                        }
+                    }
+                    game.playMove(move);
+                }
+
+                switch (game.getStatus()) {
+                    case GameState::X_WIN:
+                        results.xWins++;
+                        break;
+                    case GameState::C_WIN:
+                        results.circleWins++;
+                        break;
+                    default:
+                        results.draws++;
+                        break;
+                }
+            }
+            results.rows += rows;
+            pushBuffer(buffer);
+            results.chunksDone++;
+        });
+    }
+
+    // Write rows as chunks finish
+    while (results.chunksDone < chunks) {
+        drainBuffers(file, boardFile);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    pool.wait();
+    drainBuffers(file, boardFile);
+    file.flush();
+    boardFile.flush();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << results.rows << " rows to " << outPath << " in " << seconds << " s ("
+              << static_cast<size_t>(results.rows / std::max(seconds, 1e-9)) << " rows/s)" << std::endl;
+    std::cout << "X wins: " << results.xWins << ", O wins: " << results.circleWins << ", draws: " << results.draws << std::endl;
+    if (modelPool) {
+        modelPool->printStats(std::cout);
+    }
+
+    for (auto& entry : featureTable) {
+        delete entry.load();
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+
+#include "sessionLog.h"
+#include "constants.h"
+
+namespace {
+    constexpr char magic[] = "TTTLOG";
+    constexpr int magicLength = 6;
+    constexpr std::uint8_t version = 1;
+
+    void putVarint(std::string& out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    template <typename T>
+    void putLittle(std::string& out, const T value) {
+        for (size_t i = 0; i < sizeof(T); i++) {
+            out.push_back(static_cast<char>((static_cast<std::uint64_t>(value) >> (8 * i)) & 0xff));
+        }
+    }
+
+    // Reads fields from a log in memory. Once anything runs past the end, every read fails.
+    struct Reader {
+        const std::string& data;
+        size_t at = 0;
+        bool ok = true;
+
+        std::uint64_t varint() {
+            std::uint64_t value = 0;
+            for (int shift = 0; ok; shift += 7) {
+                if (at >= data.size() || shift > 63) {
+                    ok = false;
+                    break;
+                }
+                const std::uint8_t byte = static_cast<std::uint8_t>(data[at++]);
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) {
+                    break;
+                }
+            }
+            return value;
+        }
+
+        template <typename T>
+        T little() {
+            if (at + sizeof(T) > data.size()) {
+                ok = false;
+                return T();
+            }
+            std::uint64_t value = 0;
+            for (size_t i = 0; i < sizeof(T); i++) {
+                value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(data[at++])) << (8 * i);
+            }
+            return static_cast<T>(value);
+        }
+    };
+}
+
+bool SessionLog::open(const std::string& path, const Header& header) {
+    std::error_code error;
+    const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, error);
+    }
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "ERROR::SESSION_LOG::CANNOT_OPEN " << path << std::endl;
+        return false;
+    }
+
+    buffer.assign(magic, magicLength);
+    putLittle<std::uint8_t>(buffer, version);
+    putLittle<std::uint8_t>(buffer, static_cast<std::uint8_t>(header.rows));
+    putLittle<std::uint8_t>(buffer, static_cast<std::uint8_t>(header.cols));
+    putLittle<std::uint8_t>(buffer, (header.trainingMode ? 1 : 0) | (header.augment ? 2 : 0));
+    putLittle<std::int64_t>(buffer, static_cast<std::int64_t>(std::time(nullptr)));
+    last = std::chrono::steady_clock::now();
+    finish();
+    return true;
+}
+
+void SessionLog::begin(const EventType type) {
+    const auto now = std::chrono::steady_clock::now();
+    buffer.clear();
+    buffer.push_back(static_cast<char>(type));
+    putVarint(buffer, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - last).count()));
+    last = now;
+}
+
+void SessionLog::finish() {
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.flush();
+}
+
+void SessionLog::click(const float x, const float y, const int width, const int height, const int cell) {
+    if (!isOpen()) {
+        return;
+    }
+    begin(CLICK);
+    putLittle<std::uint32_t>(buffer, std::bit_cast<std::uint32_t>(x));
+    putLittle<std::uint32_t>(buffer, std::bit_cast<std::uint32_t>(y));
+    putLittle<std::uint16_t>(buffer, static_cast<std::uint16_t>(width));
+    putLittle<std::uint16_t>(buffer, static_cast<std::uint16_t>(height));
+    putLittle<std::int8_t>(buffer, static_cast<std::int8_t>(cell));
+    finish();
+}
+
+void SessionLog::key(const char key) {
+    if (!isOpen()) {
+        return;
+    }
+    begin(KEY);
+    buffer.push_back(key);
+    finish();
+}
+
+void SessionLog::modelRequest(const int attempt) {
+    if (!isOpen()) {
+        return;
+    }
+    begin(MODEL_REQUEST);
+    putLittle<std::uint8_t>(buffer, static_cast<std::uint8_t>(attempt));
+    finish();
+}
+
+void SessionLog::modelReply(const int move, const int attempt) {
+    if (!isOpen()) {
+        return;
+    }
+    begin(MODEL_REPLY);
+    putLittle<std::int8_t>(buffer, static_cast<std::int8_t>(move));
+    putLittle<std::uint8_t>(buffer, static_cast<std::uint8_t>(attempt));
+    finish();
+}
+
+void SessionLog::fallbackMove(const int move) {
+    if (!isOpen()) {
+        return;
+    }
+    begin(FALLBACK_MOVE);
+    putLittle<std::int8_t>(buffer, static_cast<std::int8_t>(move));
+    finish();
+}
+
+bool SessionLog::read(const std::string& path, Header& header, std::vector<Event>& events) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "ERROR::SESSION_LOG::CANNOT_OPEN " << path << std::endl;
+        return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.compare(0, magicLength, magic) != 0) {
+        std::cerr << "ERROR::SESSION_LOG::NOT_A_LOG " << path << std::endl;
+        return false;
+    }
+
+    Reader reader{data, magicLength};
+    if (reader.little<std::uint8_t>() != version) {
+        std::cerr << "ERROR::SESSION_LOG::UNKNOWN_VERSION " << path << std::endl;
+        return false;
+    }
+    header.rows = reader.little<std::uint8_t>();
+    header.cols = reader.little<std::uint8_t>();
+    const std::uint8_t flags = reader.little<std::uint8_t>();
+    header.trainingMode = flags & 1;
+    header.augment = flags & 2;
+    header.startTime = reader.little<std::int64_t>();
+    if (!reader.ok) {
+        std::cerr << "ERROR::SESSION_LOG::TRUNCATED_HEADER " << path << std::endl;
+        return false;
+    }
+
+    events.clear();
+    std::uint64_t time = 0;
+    while (reader.at < data.size()) {
+        Event event;
+        event.type = static_cast<EventType>(reader.little<std::uint8_t>());
+        time += reader.varint();
+        event.timeUs = time;
+        switch (event.type) {
+            case CLICK:
+                event.x = std::bit_cast<float>(reader.little<std::uint32_t>());
+                event.y = std::bit_cast<float>(reader.little<std::uint32_t>());
+                event.width = reader.little<std::uint16_t>();
+                event.height = reader.little<std::uint16_t>();
+                event.cell = reader.little<std::int8_t>();
+                break;
+            case KEY:
+                event.key = static_cast<char>(reader.little<std::uint8_t>());
+                break;
+            case MODEL_REQUEST:
+                event.attempt = reader.little<std::uint8_t>();
+                break;
+            case MODEL_REPLY:
+                event.cell = reader.little<std::int8_t>();
+                event.attempt = reader.little<std::uint8_t>();
+                break;
+            case FALLBACK_MOVE:
+                event.cell = reader.little<std::int8_t>();
+                break;
+            default:
+                // Nothing after an event we don't know can be read
+                std::cerr << "ERROR::SESSION_LOG::UNKNOWN_EVENT " << static_cast<int>(event.type) << " in " << path << std::endl;
+                return true;
+        }
+        if (!reader.ok) {
+            break; // Cut off part way through an event
+        }
+        events.push_back(event);
+    }
+    return true;
+}
+
+std::string SessionLog::defaultPath() {
+    const std::time_t now = std::time(nullptr);
+    char name[32];
+    std::strftime(name, sizeof(name), "%Y%m%d-%H%M%S", std::localtime(&now));
+    const std::string stem = TTT::sessionLogDir + "/" + name;
+
+    // Claim the first free name by creating it ("x" fails if it exists), so even two games started
+    // at once can't pick the same one. _1, _2 ... still sort after the name without one.
+    std::error_code error;
+    std::filesystem::create_directories(TTT::sessionLogDir, error);
+    for (int suffix = 0; suffix < 1000; suffix++) {
+        const std::string path = stem + (suffix == 0 ? "" : "_" + std::to_string(suffix)) + ".tttlog";
+        if (std::FILE* file = std::fopen(path.c_str(), "wx")) {
+            std::fclose(file);
+            return path;
+        }
+        if (errno != EEXIST) {
+            return path; // open will say why it can't be written
+        }
+    }
+    return stem + ".tttlog";
+}
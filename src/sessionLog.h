@@ -0,0 +1,78 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class SessionLog {
+    // A record of everything that happened in a session, so it can be played back without a window
+    // (main --replay) to reproduce a bug, or to export its rows again with a changed feature extractor.
+    // The file is binary and small. It starts with a header:
+    //   "TTTLOG", version (1 byte), board rows and columns (1 byte each), flags (1 byte: 1 = started in
+    //   training mode, 2 = augmenting rows), and when the session started (8 bytes, Unix seconds)
+    // followed by one event after another:
+    //   type (1 byte), microseconds since the previous event (a varint, 7 bits a byte, low bits first),
+    //   then the event's own fields (see Event).
+    // Numbers are little endian. Every event is flushed as it's written, so a crash loses nothing.
+    public:
+        enum EventType : std::uint8_t {
+            CLICK = 1, // x, y (floats, window coordinates), the window's width and height (2 bytes each), cell (1 byte, -1 off the board)
+            KEY = 2, // key (1 byte): R, T, P, M, N, or Q when the window is closed
+            MODEL_REQUEST = 3, // attempt (1 byte)
+            MODEL_REPLY = 4, // move (1 byte, -1 for none), attempt (1 byte)
+            FALLBACK_MOVE = 5 // move (1 byte), played by the fallback policy or at random instead of the model
+        };
+
+        struct Event {
+            EventType type = KEY;
+            std::uint64_t timeUs = 0; // Since the session started
+            float x = 0.0f;
+            float y = 0.0f;
+            std::uint16_t width = 0;
+            std::uint16_t height = 0;
+            int cell = -1; // The cell clicked, or the move played
+            char key = 0;
+            int attempt = 0;
+        };
+
+        struct Header {
+            int rows = 0;
+            int cols = 0;
+            bool trainingMode = true;
+            bool augment = false;
+            std::int64_t startTime = 0; // Unix seconds. Written by open, whatever it's given.
+        };
+
+        // Start a new log, creating its folder if needed. Returns false (and prints why) if it can't be written.
+        bool open(const std::string& path, const Header& header);
+
+        bool isOpen() const {return file.is_open();}
+
+        void click(const float x, const float y, const int width, const int height, const int cell);
+        void key(const char key);
+        void modelRequest(const int attempt);
+        void modelReply(const int move, const int attempt);
+        void fallbackMove(const int move);
+
+        // Read a whole log. Returns false (and prints why) if it isn't one. A log cut short
+        // (e.g. by a crash) keeps every event that was written in full.
+        static bool read(const std::string& path, Header& header, std::vector<Event>& events);
+
+        // Where a session started now is logged: TTT::sessionLogDir/<date>-<time>.tttlog, or with _1, _2 ...
+        // added if a session already started in the same second. The file is created here, so it's taken.
+        static std::string defaultPath();
+
+    private:
+        // Write the type and time of an event. Its fields follow.
+        void begin(const EventType type);
+        void finish();
+
+        std::ofstream file;
+        std::string buffer;
+        std::chrono::steady_clock::time_point last;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <array>
+
+#include "symmetry.h"
+
+namespace {
+    // cellMaps[s][cell] is where cell ends up after symmetry s
+    constexpr std::array<std::array<int, 9>, Symmetry::count> buildCellMaps() {
+        std::array<std::array<int, 9>, Symmetry::count> maps = {};
+        for (int cell = 0; cell < 9; cell++) {
+            const int r = cell / 3;
+            const int c = cell % 3;
+            // {row, col} of the cell after each symmetry, in the order listed in symmetry.h
+            const int moved[Symmetry::count][2] = {
+                {r, c},
+                {c, 2 - r},
+                {2 - r, 2 - c},
+                {2 - c, r},
+                {r, 2 - c},
+                {2 - r, c},
+                {c, r},
+                {2 - c, 2 - r}
+            };
+            for (int s = 0; s < Symmetry::count; s++) {
+                maps[s][cell] = moved[s][0] * 3 + moved[s][1];
+            }
+        }
+        return maps;
+    }
+    constexpr auto cellMaps = buildCellMaps();
+
+    // Mapping all 9 bits one at a time is slow when canonicalizing every position of a search,
+    // so every symmetry of every 9 bit bitboard is precomputed (8 * 512 entries)
+    constexpr std::array<std::array<GameState::Bitboard, 512>, Symmetry::count> buildBitMaps() {
+        std::array<std::array<GameState::Bitboard, 512>, Symmetry::count> maps = {};
+        for (int s = 0; s < Symmetry::count; s++) {
+            for (int bits = 0; bits < 512; bits++) {
+                int result = 0;
+                for (int cell = 0; cell < 9; cell++) {
+                    if (bits & (1 << cell)) result |= 1 << cellMaps[s][cell];
+                }
+                maps[s][bits] = static_cast<GameState::Bitboard>(result);
+            }
+        }
+        return maps;
+    }
+    constexpr auto bitMaps = buildBitMaps();
+}
+
+int Symmetry::mapCell(const int symmetry, const int cell) {
+    return cellMaps[symmetry][cell];
+}
+
+int Symmetry::inverse(const int symmetry) {
+    // The two quarter turns undo each other, everything else undoes itself
+    switch (symmetry) {
+        case 1:
+            return 3;
+        case 3:
+            return 1;
+        default:
+            return symmetry;
+    }
+}
+
+GameState::Bitboard Symmetry::mapBits(const int symmetry, const GameState::Bitboard bits) {
+    return bitMaps[symmetry][bits & GameState::fullBoard];
+}
+
+GameState::Grid Symmetry::mapGrid(const int symmetry, const GameState::Grid& grid) {
+    GameState::Grid result;
+    for (int cell = 0; cell < 9; cell++) {
+        const int moved = cellMaps[symmetry][cell];
+        result[moved / 3][moved % 3] = grid[cell / 3][cell % 3];
+    }
+    return result;
+}
+
+Symmetry::Canonical Symmetry::canonicalize(const GameState::Bitboard xBits, const GameState::Bitboard circleBits) {
+    Canonical best = {key(xBits, circleBits), 0};
+    for (int s = 1; s < count; s++) {
+        const std::uint32_t candidate = key(mapBits(s, xBits), mapBits(s, circleBits));
+        if (candidate < best.key) {
+            best = {candidate, s};
+        }
+    }
+    return best;
+}
+
+Symmetry::Canonical Symmetry::canonicalize(const GameState& game) {
+    return canonicalize(game.getBits(GameState::X), game.getBits(GameState::CIRCLE));
+}
+
+std::pmr::vector<int> Symmetry::distinctVariants(const GameState::Grid& grid, const int move, std::pmr::memory_resource* memory) {
+    GameState::Bitboard xBits = 0;
+    GameState::Bitboard circleBits = 0;
+    for (int cell = 0; cell < 9; cell++) {
+        const GameState::CellState state = grid[cell / 3][cell % 3];
+        if (state == GameState::X) xBits |= 1 << cell;
+        if (state == GameState::CIRCLE) circleBits |= 1 << cell;
+    }
+
+    // A variant is a repeat if some earlier symmetry already produced the same board and move
+    std::pmr::vector<int> result(memory);
+    result.reserve(count);
+    std::array<std::pair<std::uint32_t, int>, count> seen;
+    int seenCount = 0;
+    for (int s = 0; s < count; s++) {
+        const std::pair<std::uint32_t, int> variant = {key(mapBits(s, xBits), mapBits(s, circleBits)), move >= 0 ? mapCell(s, move) : move};
+        if (std::find(seen.begin(), seen.begin() + seenCount, variant) == seen.begin() + seenCount) {
+            seen[seenCount++] = variant;
+            result.push_back(s);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,52 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "gameState.h"
+
+namespace Symmetry {
+    // The board looks the same after any of 8 rotations and reflections, so positions come in
+    // groups of up to 8 that play identically. Every symmetry is numbered:
+    // 0 - identity
+    // 1, 2, 3 - rotate 90, 180, 270 degrees clockwise
+    // 4 - mirror left to right
+    // 5 - mirror top to bottom
+    // 6 - mirror across the top left to bottom right diagonal
+    // 7 - mirror across the top right to bottom left diagonal
+    constexpr int count = 8;
+
+    // Where a cell (or a move) ends up after a symmetry
+    int mapCell(const int symmetry, const int cell);
+
+    // The symmetry that undoes another
+    int inverse(const int symmetry);
+
+    // Move every set bit of a bitboard
+    GameState::Bitboard mapBits(const int symmetry, const GameState::Bitboard bits);
+
+    // Move every cell of a grid
+    GameState::Grid mapGrid(const int symmetry, const GameState::Grid& grid);
+
+    // A position as xBits | circleBits << 9
+    inline std::uint32_t key(const GameState::Bitboard xBits, const GameState::Bitboard circleBits) {
+        return xBits | (static_cast<std::uint32_t>(circleBits) << 9);
+    }
+
+    // The canonical position is the symmetric variant with the smallest key, so all 8 variants share it.
+    // symmetry is the one that takes the given position to the canonical position.
+    struct Canonical {
+        std::uint32_t key;
+        int symmetry;
+    };
+    Canonical canonicalize(const GameState::Bitboard xBits, const GameState::Bitboard circleBits);
+    Canonical canonicalize(const GameState& game);
+
+    // The symmetries that turn a board and its next move into distinct rows of training data,
+    // starting with 0 (the row itself). A board that's symmetric itself has fewer than 8.
+    std::pmr::vector<int> distinctVariants(const GameState::Grid& grid, const int move, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+}
+
+#endif
@@ -0,0 +1,94 @@
+#include <algorithm>
+
+#include "threadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, static_cast<int>(i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        const std::lock_guard<std::mutex> lock(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    const size_t index = nextQueue++ % queues.size();
+    outstanding++;
+    {
+        // Count it first so queued never drops below 0 when a worker grabs it straight away.
+        // Taking the lock means a worker can't miss this between checking queued and going to sleep.
+        const std::lock_guard<std::mutex> lock(sleepLock);
+        queued++;
+    }
+    {
+        const std::lock_guard<std::mutex> lock(queues[index]->lock);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(sleepLock);
+    idle.wait(lock, [this] {return outstanding == 0;});
+}
+
+bool ThreadPool::takeTask(const int worker, Task& task) {
+    // Newest task from our own queue first
+    {
+        WorkQueue& own = *queues[worker];
+        const std::lock_guard<std::mutex> lock(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Then the oldest task from everyone else, starting with our neighbour
+    for (size_t i = 1; i < queues.size(); i++) {
+        WorkQueue& other = *queues[(worker + i) % queues.size()];
+        const std::lock_guard<std::mutex> lock(other.lock);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(const int worker) {
+    while (true) {
+        Task task;
+        if (takeTask(worker, task)) {
+            queued--;
+            task(worker);
+            if (--outstanding == 0) {
+                const std::lock_guard<std::mutex> lock(sleepLock);
+                idle.notify_all();
+            }
+            continue;
+        }
+
+        // Nothing to do, sleep until a task is submitted
+        std::unique_lock<std::mutex> lock(sleepLock);
+        wake.wait(lock, [this] {return stopping || queued > 0;});
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+    // A fixed set of worker threads that run tasks. Every worker has its own queue of tasks.
+    // A worker takes tasks from the back of its own queue, and when that's empty it steals from
+    // the front of another worker's queue, so nobody sits idle while there's work left.
+    public:
+        // A task is told the index of the worker running it, so it can use per-worker state
+        using Task = std::function<void(const int worker)>;
+
+        // 0 threads means one per core
+        explicit ThreadPool(unsigned int threads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Queue a task. Tasks are spread across the workers' queues in turn.
+        void submit(Task task);
+
+        // Block until every submitted task has finished
+        void wait();
+
+        int size() const {return static_cast<int>(workers.size());}
+
+    private:
+        struct WorkQueue {
+            std::mutex lock;
+            std::deque<Task> tasks;
+        };
+
+        // Take a task from our own queue, or steal one. Returns false if every queue is empty.
+        bool takeTask(const int worker, Task& task);
+
+        void workerLoop(const int worker);
+
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> nextQueue = 0;
+
+        // Sleeping workers wait here for new tasks, wait() waits here for outstanding to reach 0
+        std::mutex sleepLock;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::atomic<size_t> queued = 0;
+        std::atomic<size_t> outstanding = 0;
+        bool stopping = false;
+};
+
+#endif
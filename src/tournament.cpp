@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "constants.h"
+#include "gameState.h"
+#include "modelPool.h"
+#include "nativeModel.h"
+#include "policy.h"
+#include "threadPool.h"
+
+// Measure how strong and how fast two policies are by letting them play each other.
+// Games are played in chunks on a work-stealing thread pool, with the policies swapping sides
+// every game, so each plays first in half of them. A policy that returns an illegal move (or no
+// move) forfeits the game. Every move is timed, and the results come with 95% confidence intervals.
+
+namespace {
+    // Everything a worker thread keeps between chunks. Only that thread touches it.
+    struct WorkerState {
+        std::array<std::unique_ptr<Policy>, 2> policies;
+        std::array<std::array<std::uint64_t, 3>, 2> results = {}; // [policy][win, draw, loss], policy 0 is A
+        std::array<std::array<std::uint64_t, 3>, 2> asX = {}; // The same, for games where that policy played X
+        std::array<std::uint64_t, 2> moves = {};
+        std::array<std::uint64_t, 2> forfeits = {};
+        std::array<std::vector<float>, 2> latencyUs;
+    };
+
+    // The Wilson score interval for a proportion, which behaves near 0 and 1 unlike the normal one
+    std::array<double, 2> wilson(const std::uint64_t hits, const std::uint64_t total) {
+        if (total == 0) {
+            return {0.0, 1.0};
+        }
+        constexpr double z = 1.96;
+        const double n = static_cast<double>(total);
+        const double p = hits / n;
+        const double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+        const double margin = z * std::sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / (1 + z * z / n);
+        return {std::max(0.0, center - margin), std::min(1.0, center + margin)};
+    }
+
+    // Elo difference for a score (wins plus half the draws, over games), capped for a clean sweep
+    double elo(const double score) {
+        const double clamped = std::clamp(score, 1e-4, 1.0 - 1e-4);
+        return 400.0 * std::log10(clamped / (1.0 - clamped));
+    }
+
+    // The value below which a fraction of the sorted latencies fall (nearest rank)
+    float percentile(const std::vector<float>& sorted, const double fraction) {
+        if (sorted.empty()) {
+            return 0.0f;
+        }
+        const size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    std::string percent(const double value) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << value * 100.0 << "%";
+        return out.str();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Parse command line flags
+    size_t games = 1000;
+    unsigned int threads = 0;
+    size_t chunkSize = 16;
+    std::array<std::string, 2> specs = {"perfect", "random"};
+    std::uint32_t seed = std::random_device()();
+    int modelWorkers = 0;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--games" && hasValue) {
+            games = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (arg == "--threads" && hasValue) {
+            threads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--chunk" && hasValue) {
+            chunkSize = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (arg == "--a" && hasValue) {
+            specs[0] = argv[++i];
+        } else if (arg == "--b" && hasValue) {
+            specs[1] = argv[++i];
+        } else if (arg == "--seed" && hasValue) {
+            seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--model-workers" && hasValue) {
+            modelWorkers = std::stoi(argv[++i]);
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: tournament [--a POLICY] [--b POLICY] [--games N] [--threads N] [--chunk N] [--seed N] [--model-workers N]" << std::endl;
+            std::cerr << policySpecHelp() << std::endl;
+            return -1;
+        }
+    }
+
+    // Make sure the policies exist before starting any threads. A native model that won't load would
+    // quietly be replaced by perfect play, which is no use for measuring it.
+    for (const std::string& spec : specs) {
+        if (!isPolicySpec(spec)) {
+            std::cerr << "ERROR::TOURNAMENT::UNKNOWN_POLICY " << spec << std::endl;
+            std::cerr << policySpecHelp() << std::endl;
+            return -1;
+        }
+        if (spec.rfind("native", 0) == 0 && !NativeModel().load(spec == "native" ? TTT::nativeModelPath : spec.substr(7))) {
+            return -1;
+        }
+    }
+
+    ThreadPool pool(threads);
+    std::vector<WorkerState> workerStates(pool.size());
+
+    // Start the models up front, one per thread unless told otherwise
+    std::shared_ptr<ModelPool> modelPool;
+    if (specs[0] == "model" || specs[1] == "model") {
+        modelPool = std::make_shared<ModelPool>(modelWorkers > 0 ? modelWorkers : pool.size(), TTT::modelCommand);
+        if (!modelPool->waitUntilReady(TTT::modelStartTimeoutMs)) {
+            std::cerr << "ERROR::TOURNAMENT::MODEL_NOT_READY, the perfect policy will play for the model until it starts" << std::endl;
+        }
+    }
+    std::cout << "Playing " << games << " games of " << specs[0] << " (A) vs " << specs[1] << " (B) on " << pool.size()
+              << " threads, seed " << seed << std::endl;
+
+    const auto start = std::chrono::steady_clock::now();
+    const size_t chunks = (games + chunkSize - 1) / chunkSize;
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        const size_t first = chunk * chunkSize;
+        const size_t chunkGames = std::min(chunkSize, games - first);
+        pool.submit([&, chunk, first, chunkGames](const int worker) {
+            WorkerState& state = workerStates[worker];
+            if (!state.policies[0]) {
+                state.policies[0] = createPolicy(specs[0], modelPool);
+                state.policies[1] = createPolicy(specs[1], modelPool);
+            }
+
+            // Every chunk has its own generator, so a seed plays the same games whichever thread runs them
+            std::seed_seq seq = {seed, static_cast<std::uint32_t>(chunk)};
+            std::mt19937 rng(seq);
+
+            GameState game;
+            for (size_t g = first; g < first + chunkGames; g++) {
+                // A plays X in even games and B in odd ones
+                const int xPlayer = static_cast<int>(g % 2);
+                game.reset();
+                int loser = -1;
+                while (!game.isOver()) {
+                    const int player = game.getTurn() == 0 ? xPlayer : 1 - xPlayer;
+                    const auto moveStart = std::chrono::steady_clock::now();
+                    const int move = state.policies[player]->chooseMove(game, rng);
+                    state.latencyUs[player].push_back(std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - moveStart).count());
+                    state.moves[player]++;
+                    if (!game.playMove(move)) {
+                        state.forfeits[player]++;
+                        loser = player;
+                        break;
+                    }
+                }
+
+                // -1 for a draw
+                int winner = -1;
+                if (loser >= 0) {
+                    winner = 1 - loser;
+                } else if (game.getStatus() == GameState::X_WIN || game.getStatus() == GameState::C_WIN) {
+                    winner = game.getStatus() == GameState::X_WIN ? xPlayer : 1 - xPlayer;
+                }
+                for (int player = 0; player < 2; player++) {
+                    const int outcome = winner < 0 ? 1 : winner == player ? 0 : 2;
+                    state.results[player][outcome]++;
+                    if (player == xPlayer) {
+                        state.asX[player][outcome]++;
+                    }
+                }
+            }
+        });
+    }
+    pool.wait();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Add up every worker
+    WorkerState total;
+    std::array<std::uint64_t, 2> illegal = {};
+    for (WorkerState& state : workerStates) {
+        for (int player = 0; player < 2; player++) {
+            for (int outcome = 0; outcome < 3; outcome++) {
+                total.results[player][outcome] += state.results[player][outcome];
+                total.asX[player][outcome] += state.asX[player][outcome];
+            }
+            total.moves[player] += state.moves[player];
+            total.forfeits[player] += state.forfeits[player];
+            total.latencyUs[player].insert(total.latencyUs[player].end(), state.latencyUs[player].begin(), state.latencyUs[player].end());
+            if (state.policies[player]) {
+                illegal[player] += state.policies[player]->illegalMoves();
+            }
+        }
+    }
+
+    std::cout << "Played " << games << " games in " << seconds << " s (" << static_cast<size_t>(games / std::max(seconds, 1e-9)) << " games/s)" << std::endl;
+    const std::array<std::string, 3> outcomeNames = {"wins", "draws", "losses"};
+    for (int player = 0; player < 2; player++) {
+        const auto& results = total.results[player];
+        std::cout << (player == 0 ? "A: " : "B: ") << specs[player] << std::endl;
+        for (int outcome = 0; outcome < 3; outcome++) {
+            const auto interval = wilson(results[outcome], games);
+            std::cout << "    " << std::setw(7) << std::left << outcomeNames[outcome] << std::right << std::setw(8) << results[outcome]
+                      << "  " << percent(static_cast<double>(results[outcome]) / games)
+                      << " [" << percent(interval[0]) << ", " << percent(interval[1]) << "]" << std::endl;
+        }
+        const size_t gamesAsX = (games + 1 - player) / 2;
+        std::cout << "    as X: " << total.asX[player][0] << " wins, " << total.asX[player][1] << " draws, " << total.asX[player][2] << " losses in "
+                  << gamesAsX << " games" << std::endl;
+
+        // The score's interval is the normal one, from the spread of per-game scores (1, 0.5 or 0)
+        const double score = (results[0] + 0.5 * results[1]) / games;
+        const double meanSquare = (results[0] + 0.25 * results[1]) / games;
+        const double margin = 1.96 * std::sqrt(std::max(0.0, meanSquare - score * score) / games);
+        std::cout << "    score " << std::fixed << std::setprecision(3) << score << " [" << std::max(0.0, score - margin) << ", "
+                  << std::min(1.0, score + margin) << "], Elo " << std::showpos << std::setprecision(0) << elo(score)
+                  << " [" << elo(score - margin) << ", " << elo(score + margin) << "]" << std::noshowpos << std::endl;
+
+        // Moves whose first choice was illegal (replaced by the policy, or forfeited), per move played
+        const std::uint64_t moves = total.moves[player];
+        std::cout << "    illegal moves: " << illegal[player] + total.forfeits[player] << " in " << moves << " moves ("
+                  << percent(moves ? static_cast<double>(illegal[player] + total.forfeits[player]) / moves : 0.0) << "), "
+                  << total.forfeits[player] << " forfeited games" << std::endl;
+
+        std::vector<float>& latency = total.latencyUs[player];
+        std::sort(latency.begin(), latency.end());
+        double sum = 0.0;
+        for (const float value : latency) {
+            sum += value;
+        }
+        std::cout << std::setprecision(1) << "    move latency (us): mean " << (latency.empty() ? 0.0 : sum / latency.size()) << ", p50 " << percentile(latency, 0.5)
+                  << ", p90 " << percentile(latency, 0.9) << ", p99 " << percentile(latency, 0.99) << ", max " << percentile(latency, 1.0) << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+    if (modelPool) {
+        modelPool->printStats(std::cout);
+    }
+    return 0;
+}